@@ -0,0 +1,180 @@
+#include "CorpusGenerator.h"
+#include <stdexcept>
+
+namespace {
+
+    const char* const words[] = {
+        "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+        "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa",
+        "caf\xC3\xA9", "na\xC3\xAFve", "\xE6\x9D\xB1\xE4\xBA\xAC", "\xF0\x9F\x98\x80"
+    };
+
+    const char* const escapes[] = {
+        "\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t",
+        "\\u00e9", "\\u4e2d", "\\ud83d\\ude00", "\\u0001"
+    };
+
+    constexpr std::size_t flushSize = std::size_t(1) << 20;
+}
+
+constexpr CorpusGenerator::Kind CorpusGenerator::allKinds[];
+
+const char* CorpusGenerator::name(Kind kind) {
+    switch (kind) {
+        case Kind::Deep: return "deep";
+        case Kind::Wide: return "wide";
+        case Kind::Numeric: return "numeric";
+        case Kind::Strings: return "strings";
+        case Kind::Escapes: return "escapes";
+    }
+    return "";
+}
+
+CorpusGenerator::Kind CorpusGenerator::kindOf(std::string_view kindName) {
+    for (Kind kind : allKinds) {
+        if (kindName == name(kind)) {
+            return kind;
+        }
+    }
+    throw std::runtime_error("Unknown corpus kind: " + std::string(kindName));
+}
+
+CorpusGenerator::CorpusGenerator(Kind kind, std::ostream &out)
+    : state(0x9E3779B97F4A7C15ULL * (std::uint64_t(kind) + 1)), out(out) {}
+
+void CorpusGenerator::generate(Kind kind, std::size_t size, std::ostream &out) {
+    CorpusGenerator generator(kind, out);
+    std::size_t written = 0;
+
+    generator.buffer.push_back('[');
+    for (std::uint64_t index = 0; written + generator.buffer.size() + 1 < size || index == 0; ++index) {
+        if (index > 0) {
+            generator.buffer.push_back(',');
+        }
+        generator.element(kind, index);
+
+        if (generator.buffer.size() >= flushSize) {
+            written += generator.buffer.size();
+            generator.flush();
+        }
+    }
+    generator.buffer.push_back(']');
+    generator.flush(true);
+}
+
+std::uint64_t CorpusGenerator::next() {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t CorpusGenerator::below(std::uint64_t bound) {
+    return next() % bound;
+}
+
+void CorpusGenerator::flush(bool force) {
+    if (force || buffer.size() >= flushSize) {
+        out.write(buffer.data(), std::streamsize(buffer.size()));
+        buffer.clear();
+    }
+}
+
+void CorpusGenerator::element(Kind kind, std::uint64_t index) {
+    switch (kind) {
+        case Kind::Deep:
+            deep(100);
+            break;
+
+        case Kind::Wide:
+            buffer.push_back('{');
+            for (int i = 0; i < 256; ++i) {
+                buffer += i == 0 ? "\"field_" : ",\"field_";
+                buffer += std::to_string(i);
+                buffer += "\":";
+                switch (below(4)) {
+                    case 0: buffer += std::to_string(below(1000000)); break;
+                    case 1: buffer.push_back('"'); word(); buffer.push_back('"'); break;
+                    case 2: buffer += below(2) ? "true" : "false"; break;
+                    default: buffer += "null"; break;
+                }
+            }
+            buffer.push_back('}');
+            break;
+
+        case Kind::Numeric:
+            buffer.push_back('[');
+            for (int i = 0; i < 64; ++i) {
+                if (i > 0) {
+                    buffer.push_back(',');
+                }
+                switch (below(3)) {
+                    case 0: buffer += std::to_string(std::int64_t(next())); break;
+                    case 1: buffer += std::to_string(below(100000)); break;
+                    default:
+                        buffer += std::to_string(below(2000000)) + "." + std::to_string(below(1000000));
+                        if (below(2)) {
+                            buffer += "e" + std::to_string(int(below(40)) - 20);
+                        }
+                        break;
+                }
+            }
+            buffer.push_back(']');
+            break;
+
+        case Kind::Strings: {
+            buffer += "{\"id\":" + std::to_string(index) + ",\"text\":\"";
+            const std::uint64_t count = 20 + below(300);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                if (i > 0) {
+                    buffer.push_back(' ');
+                }
+                word();
+            }
+            buffer += "\",\"tags\":[";
+            for (int i = 0; i < 4; ++i) {
+                buffer += i == 0 ? "\"" : ",\"";
+                word();
+                buffer.push_back('"');
+            }
+            buffer += "]}";
+            break;
+        }
+
+        case Kind::Escapes: {
+            buffer += "{\"id\":" + std::to_string(index) + ",\"text\":\"";
+            const std::uint64_t count = 20 + below(200);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                if (below(4) == 0) {
+                    word();
+                } else {
+                    buffer += escapes[below(sizeof(escapes) / sizeof(escapes[0]))];
+                }
+            }
+            buffer += "\"}";
+            break;
+        }
+    }
+}
+
+void CorpusGenerator::deep(int depth) {
+    if (depth == 0) {
+        buffer += std::to_string(below(1000));
+        return;
+    }
+
+    // Objects and arrays alternate, each level also holds a scalar next to the nested value
+    if (depth % 2 == 0) {
+        buffer += "{\"level\":" + std::to_string(depth) + ",\"child\":";
+        deep(depth - 1);
+        buffer.push_back('}');
+    } else {
+        buffer += "[" + std::to_string(depth) + ",";
+        deep(depth - 1);
+        buffer.push_back(']');
+    }
+}
+
+void CorpusGenerator::word() {
+    buffer += words[below(sizeof(words) / sizeof(words[0]))];
+}
@@ -0,0 +1,54 @@
+#ifndef CORPUSGENERATOR_H
+#define CORPUSGENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+// Synthetic JSON documents for json_bench. The output only depends on the kind and the size,
+// so a corpus can be regenerated anywhere and compared between runs.
+class CorpusGenerator {
+
+public:
+
+    enum class Kind {
+        Deep,    // objects and arrays nested 100 levels deep
+        Wide,    // objects of 256 members
+        Numeric, // arrays of integers and doubles
+        Strings, // long plain and UTF-8 strings
+        Escapes  // strings made mostly of escape sequences
+    };
+
+    static constexpr Kind allKinds[] = {Kind::Deep, Kind::Wide, Kind::Numeric, Kind::Strings, Kind::Escapes};
+
+    static const char* name(Kind);
+
+    // Kind of a name, throws if there is none
+    static Kind kindOf(std::string_view name);
+
+    // Write a document of the kind: a root array whose elements are added until it is at least size bytes long
+    static void generate(Kind, std::size_t size, std::ostream&);
+
+private:
+
+    // splitmix64, small and the same on every platform
+    std::uint64_t state;
+    std::string buffer;
+    std::ostream& out;
+
+    CorpusGenerator(Kind kind, std::ostream& out);
+
+    std::uint64_t next();
+    std::uint64_t below(std::uint64_t bound);
+
+    // Hand the buffered text to the stream once it is large enough, or at the end
+    void flush(bool force = false);
+
+    void element(Kind, std::uint64_t index);
+    void deep(int depth);
+    void word();
+};
+
+#endif
@@ -0,0 +1,557 @@
+#include "../include/JsonParser.h"
+#include "../include/BinaryDocument.h"
+#include "../include/JsonBuilder.h"
+#include "../include/MappedFile.h"
+#include "CorpusGenerator.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <optional>
+#include <sys/stat.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define JSON_BENCH_FORK 1
+#endif
+
+// json_bench [--sizes 1K,1M,16M] [--kinds deep,wide,numeric,strings,escapes] [--repeat 3] [--dir json_bench_corpus]
+//
+// Generates the corpora that are missing, then measures readFromFile, readDocument, destroying what they read (destroy,
+// destroyDocument), parse, parseEvents, modifyJson and printToFile on each, writing and reading back the binary encoding (printBinaryToFile, readBinaryFromFile,
+// readBinaryDocument, readBinary), and rebuilding the parsed tree through the copying constructors, the moving ones
+// and a JsonBuilder.
+// Every measurement is printed as one JSON object per line:
+//   {"corpus":"numeric","bytes":1048576,"operation":"parse","seconds":0.0021,"mb_per_s":476.2,
+//    "nodes":65601,"ns_per_node":32.0,"allocations":1025,"peak_rss_kb":9120}
+// seconds is the best of the repeats, allocations the operator new calls of one run, and peak_rss_kb the peak
+// resident size of the process running the measurement, each measurement running in its own process when
+// fork is available. The binary operations add binary_bytes, the size of the encoded corpus.
+
+namespace {
+
+    std::atomic<std::uint64_t> allocationCount{0};
+
+    struct Measurement {
+        double seconds = 0;
+        std::uint64_t bytes = 0;      // input or output size, 0 when MB/s does not apply
+        std::uint64_t items = 0;      // nodes, or modifications for modifyJson
+        std::uint64_t allocations = 0;
+        std::uint64_t peakRssKb = 0;
+        std::uint64_t binaryBytes = 0; // size of the binary file, for the binary operations
+        bool failed = false;
+    };
+
+    std::uint64_t peakRssKb() {
+#ifdef JSON_BENCH_FORK
+        struct rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return std::uint64_t(usage.ru_maxrss) / 1024;
+#else
+        return std::uint64_t(usage.ru_maxrss);
+#endif
+#else
+        return 0;
+#endif
+    }
+
+    std::uint64_t fileSize(const std::string& filename) {
+        struct stat st{};
+        return ::stat(filename.c_str(), &st) == 0 ? std::uint64_t(st.st_size) : 0;
+    }
+
+    std::size_t parseSize(std::string_view text) {
+        std::size_t multiplier = 1;
+        switch (text.empty() ? '\0' : text.back()) {
+            case 'K': case 'k': multiplier = std::size_t(1) << 10; break;
+            case 'M': case 'm': multiplier = std::size_t(1) << 20; break;
+            case 'G': case 'g': multiplier = std::size_t(1) << 30; break;
+            default: break;
+        }
+        if (multiplier != 1) {
+            text.remove_suffix(1);
+        }
+        return std::size_t(std::stoull(std::string(text))) * multiplier;
+    }
+
+    std::vector<std::string_view> split(std::string_view list) {
+        std::vector<std::string_view> parts;
+        while (!list.empty()) {
+            const std::size_t comma = list.find(',');
+            parts.push_back(list.substr(0, comma));
+            list = comma == list.npos ? std::string_view() : list.substr(comma + 1);
+        }
+        return parts;
+    }
+
+    std::uint64_t countNodes(const JsonValue& value) {
+        std::uint64_t count = 1;
+        if (value.isObject()) {
+            for (const auto& member : value.getAsObject()) {
+                count += countNodes(member.second);
+            }
+        } else if (value.isArray()) {
+            for (const JsonValue& element : value.getAsArray()) {
+                count += countNodes(element);
+            }
+        }
+        return count;
+    }
+
+    // Path of the first leaf below every element of the root array, at most limit of them
+    std::vector<std::pair<JsonValue::pathInJson, bool>> leafPaths(const JsonValue& root, std::size_t limit) {
+        std::vector<std::pair<JsonValue::pathInJson, bool>> paths;
+        const JsonValue::JsonArray& elements = root.getAsArray();
+        for (std::size_t i = 0; i < elements.size() && paths.size() < limit; ++i) {
+            JsonValue::pathInJson path{i};
+            const JsonValue* node = &elements[i];
+            bool inArray = true;
+            while ((node->isObject() && !node->getAsObject().empty()) || (node->isArray() && !node->getAsArray().empty())) {
+                if (node->isObject()) {
+                    const auto& member = *node->getAsObject().begin();
+                    path.emplace_back(std::string(member.first.view()));
+                    node = &member.second;
+                    inArray = false;
+                } else {
+                    path.emplace_back(std::size_t(0));
+                    node = &node->getAsArray()[0];
+                    inArray = true;
+                }
+            }
+            // modifyJson finds the parent by comparing components, a last one equal to the one before it would be taken for it
+            if (path.size() >= 2 && path.back() != path[path.size() - 2]) {
+                paths.emplace_back(std::move(path), inArray);
+            }
+        }
+        return paths;
+    }
+
+    // The tree built again bottom-up as user code would, every value being wrapped in its parent by copy or by move.
+    // Copying copies each subtree once per level above it.
+    JsonValue rebuild(const JsonValue& value, bool move) {
+        if (value.isObject()) {
+            JsonValue::JsonObject obj;
+            for (const auto& member : value.getAsObject()) {
+                JsonValue child = rebuild(member.second, move);
+                obj.insert_or_assign(JsonKey(member.first.view()), move ? std::move(child) : JsonValue(child));
+            }
+            return move ? JsonValue(std::move(obj)) : JsonValue(static_cast<const JsonValue::JsonObject&>(obj));
+        }
+        if (value.isArray()) {
+            JsonValue::JsonArray arr;
+            for (const JsonValue& element : value.getAsArray()) {
+                JsonValue child = rebuild(element, move);
+                arr.push_back(move ? std::move(child) : JsonValue(child));
+            }
+            return move ? JsonValue(std::move(arr)) : JsonValue(static_cast<const JsonValue::JsonArray&>(arr));
+        }
+        if (value.isString()) {
+            JsonValue::JsonString str(value.getAsStringView());
+            return move ? JsonValue(std::move(str)) : JsonValue(static_cast<const JsonValue::JsonString&>(str));
+        }
+        return value;
+    }
+
+    // The same tree made by a JsonBuilder
+    void replay(const JsonValue& value, JsonBuilder& builder) {
+        if (value.isObject()) {
+            builder.beginObject();
+            for (const auto& member : value.getAsObject()) {
+                builder.key(member.first.view());
+                replay(member.second, builder);
+            }
+            builder.endObject();
+        } else if (value.isArray()) {
+            builder.beginArray();
+            for (const JsonValue& element : value.getAsArray()) {
+                replay(element, builder);
+            }
+            builder.endArray();
+        } else if (value.isString()) {
+            builder.value(value.getAsStringView());
+        } else {
+            builder.value(value);
+        }
+    }
+
+    // Best time of repeat runs of work, prepare runs before each of them and is not timed
+    Measurement measure(int repeat, const std::function<void()>& prepare, const std::function<void()>& work) {
+        Measurement result;
+        result.seconds = 1e300;
+        for (int run = 0; run < repeat; ++run) {
+            prepare();
+            const std::uint64_t allocationsBefore = allocationCount.load();
+            const auto start = std::chrono::steady_clock::now();
+            work();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (run == 0) {
+                result.allocations = allocationCount.load() - allocationsBefore;
+            }
+            result.seconds = std::min(result.seconds, seconds);
+        }
+        return result;
+    }
+
+    // Run the measurement in a child process so its peak memory is its own
+    Measurement isolated(const std::function<Measurement()>& run) {
+#ifdef JSON_BENCH_FORK
+        int channel[2];
+        if (::pipe(channel) == 0) {
+            const pid_t child = ::fork();
+            if (child == 0) {
+                ::close(channel[0]);
+                Measurement result;
+                try {
+                    result = run();
+                } catch (const std::exception&) {
+                    result.failed = true;
+                }
+                result.peakRssKb = peakRssKb();
+                const ssize_t written = ::write(channel[1], &result, sizeof(result));
+                ::_exit(written == ssize_t(sizeof(result)) ? 0 : 1);
+            }
+
+            ::close(channel[1]);
+            Measurement result;
+            result.failed = true;
+            if (child > 0) {
+                if (::read(channel[0], &result, sizeof(result)) != ssize_t(sizeof(result))) {
+                    result = Measurement();
+                    result.failed = true;
+                }
+                ::waitpid(child, nullptr, 0);
+            }
+            ::close(channel[0]);
+            return result;
+        }
+#endif
+        Measurement result;
+        try {
+            result = run();
+        } catch (const std::exception&) {
+            result.failed = true;
+        }
+        result.peakRssKb = peakRssKb();
+        return result;
+    }
+
+    void report(const char* corpus, std::uint64_t corpusBytes, const char* operation, const std::string& item,
+                const Measurement& result) {
+        JsonValue line{JsonValue::JsonObject()};
+        line["corpus"] = JsonValue(JsonValue::JsonString(corpus));
+        line["bytes"] = JsonValue(JsonValue::JsonUnsigned(corpusBytes));
+        line["operation"] = JsonValue(JsonValue::JsonString(operation));
+
+        if (result.failed) {
+            line["failed"] = JsonValue(true);
+        } else {
+            line["seconds"] = JsonValue(result.seconds);
+            if (result.bytes > 0) {
+                line["mb_per_s"] = JsonValue(double(result.bytes) / (1 << 20) / result.seconds);
+            }
+            line[item + "s"] = JsonValue(JsonValue::JsonUnsigned(result.items));
+            line["ns_per_" + item] = JsonValue(result.seconds * 1e9 / double(std::max<std::uint64_t>(result.items, 1)));
+            line["allocations"] = JsonValue(JsonValue::JsonUnsigned(result.allocations));
+            line["peak_rss_kb"] = JsonValue(JsonValue::JsonUnsigned(result.peakRssKb));
+            if (result.binaryBytes > 0) {
+                line["binary_bytes"] = JsonValue(JsonValue::JsonUnsigned(result.binaryBytes));
+            }
+        }
+
+        std::cout << JsonWriter::toString(line) << std::endl;
+    }
+}
+
+// Every allocation of the process is counted. The pmr default resource allocates with an alignment,
+// so the aligned forms are replaced as well
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    // aligned_alloc wants a multiple of the alignment
+    const std::size_t align = std::size_t(alignment);
+    if (void* memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::size_t> sizes{std::size_t(1) << 10, std::size_t(1) << 20, std::size_t(16) << 20};
+    std::vector<CorpusGenerator::Kind> kinds(std::begin(CorpusGenerator::allKinds), std::end(CorpusGenerator::allKinds));
+    int repeat = 3;
+    std::string directory = "json_bench_corpus";
+
+    try {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const std::string_view option = argv[i];
+            if (option == "--sizes") {
+                sizes.clear();
+                for (std::string_view size : split(argv[i + 1])) {
+                    sizes.push_back(parseSize(size));
+                }
+            } else if (option == "--kinds") {
+                kinds.clear();
+                for (std::string_view kind : split(argv[i + 1])) {
+                    kinds.push_back(CorpusGenerator::kindOf(kind));
+                }
+            } else if (option == "--repeat") {
+                repeat = std::max(1, std::atoi(argv[i + 1]));
+            } else if (option == "--dir") {
+                directory = argv[i + 1];
+            } else {
+                throw std::runtime_error("Unknown option: " + std::string(option));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\nusage: json_bench [--sizes 1K,1M,16M] [--kinds deep,wide,numeric,strings,escapes]"
+                     " [--repeat 3] [--dir json_bench_corpus]" << std::endl;
+        return 1;
+    }
+
+#ifdef JSON_BENCH_FORK
+    ::mkdir(directory.c_str(), 0755);
+#endif
+
+    for (CorpusGenerator::Kind kind : kinds) {
+        for (std::size_t size : sizes) {
+            const char* corpus = CorpusGenerator::name(kind);
+            const std::string filename = directory + "/" + corpus + "-" + std::to_string(size) + ".json";
+
+            // The corpus is written once, the generator always gives the same bytes
+            if (fileSize(filename) < size) {
+                std::ofstream file(filename, std::ios::binary);
+                if (!file.is_open()) {
+                    std::cerr << "Unable to write " << filename << std::endl;
+                    return 1;
+                }
+                CorpusGenerator::generate(kind, size, file);
+            }
+            const std::uint64_t bytes = fileSize(filename);
+
+            report(corpus, bytes, "readFromFile", "node", isolated([&] {
+                JsonParser parser;
+                JsonValue value;
+                Measurement result = measure(repeat, [&] { value = JsonValue(); }, [&] { value = parser.readFromFile(filename); });
+                result.bytes = bytes;
+                result.items = countNodes(value);
+                return result;
+            }));
+
+            report(corpus, bytes, "readDocument", "node", isolated([&] {
+                JsonParser parser;
+                JsonDocument document;
+                Measurement result = measure(repeat, [&] { document = JsonDocument(); }, [&] {
+                    document = parser.readDocument(filename);
+                });
+                result.bytes = bytes;
+                result.items = countNodes(document.getRoot());
+                return result;
+            }));
+
+            // Destroying the trees read, the reads are not timed
+            report(corpus, bytes, "destroy", "node", isolated([&] {
+                JsonParser parser;
+                JsonValue value;
+                std::uint64_t nodes = 0;
+                Measurement result = measure(repeat, [&] {
+                    value = parser.readFromFile(filename);
+                    nodes = countNodes(value);
+                }, [&] { value = JsonValue(); });
+                result.items = nodes;
+                return result;
+            }));
+
+            report(corpus, bytes, "destroyDocument", "node", isolated([&] {
+                JsonParser parser;
+                std::optional<JsonDocument> document;
+                std::uint64_t nodes = 0;
+                Measurement result = measure(repeat, [&] {
+                    document = parser.readDocument(filename);
+                    nodes = countNodes(document->getRoot());
+                }, [&] { document.reset(); });
+                result.items = nodes;
+                return result;
+            }));
+
+            report(corpus, bytes, "parse", "node", isolated([&] {
+                JsonParser parser;
+                const MappedFile file(filename);
+                const std::string text(file.view());
+                JsonValue value;
+                Measurement result = measure(repeat, [&] { value = JsonValue(); }, [&] { value = parser.parse(text); });
+                result.bytes = bytes;
+                result.items = countNodes(value);
+                return result;
+            }));
+
+            report(corpus, bytes, "parseEvents", "node", isolated([&] {
+                const MappedFile file(filename);
+                const std::string text(file.view());
+                JsonValue value;
+                Measurement result = measure(repeat, [&] { value = JsonValue(); }, [&] {
+                    JsonValueBuilder builder;
+                    JsonStreamParser parser(builder);
+                    parser.feed(text);
+                    parser.finish();
+                    value = builder.takeResult();
+                });
+                result.bytes = bytes;
+                result.items = countNodes(value);
+                return result;
+            }));
+
+            report(corpus, bytes, "modifyJson", "modification", isolated([&] {
+                JsonParser parser;
+                JsonValue value;
+                std::vector<std::pair<JsonValue::pathInJson, bool>> paths;
+                Measurement result = measure(repeat, [&] {
+                    value = parser.readFromFile(filename);
+                    paths = leafPaths(value, 100000);
+                }, [&] {
+                    for (const auto& path : paths) {
+                        value.modifyJson(path.first, JsonValue(JsonValue::JsonInteger(7)), path.second);
+                    }
+                });
+                result.items = paths.size();
+                return result;
+            }));
+
+            report(corpus, bytes, "printToFile", "node", isolated([&] {
+                JsonParser parser;
+                const std::string output = directory + "/" + corpus + "-" + std::to_string(size) + ".out.json";
+                const JsonValue value = parser.readFromFile(filename);
+                Measurement result = measure(repeat, [] {}, [&] { parser.printToFile(output, value); });
+                result.bytes = fileSize(output);
+                result.items = countNodes(value);
+                std::remove(output.c_str());
+                return result;
+            }));
+
+            // The binary encoding of the corpus, kept for the reads that follow
+            const std::string binary = directory + "/" + corpus + "-" + std::to_string(size) + ".bin";
+            report(corpus, bytes, "printBinaryToFile", "node", isolated([&] {
+                JsonParser parser;
+                const JsonValue value = parser.readFromFile(filename);
+                Measurement result = measure(repeat, [] {}, [&] { parser.printBinaryToFile(binary, value); });
+                result.bytes = fileSize(binary);
+                result.binaryBytes = result.bytes;
+                result.items = countNodes(value);
+                return result;
+            }));
+            const std::uint64_t binaryBytes = fileSize(binary);
+
+            report(corpus, bytes, "readBinaryFromFile", "node", isolated([&] {
+                JsonParser parser;
+                JsonValue value;
+                Measurement result = measure(repeat, [&] { value = JsonValue(); }, [&] {
+                    value = parser.readBinaryFromFile(binary);
+                });
+                result.bytes = binaryBytes;
+                result.binaryBytes = binaryBytes;
+                result.items = countNodes(value);
+                return result;
+            }));
+
+            report(corpus, bytes, "readBinaryDocument", "node", isolated([&] {
+                JsonParser parser;
+                JsonDocument document;
+                Measurement result = measure(repeat, [&] { document = JsonDocument(); }, [&] {
+                    document = parser.readBinaryDocument(binary);
+                });
+                result.bytes = binaryBytes;
+                result.binaryBytes = binaryBytes;
+                result.items = countNodes(document.getRoot());
+                return result;
+            }));
+
+            // Mapping the file and reaching the root, nothing else is decoded
+            report(corpus, bytes, "readBinary", "document", isolated([&] {
+                JsonParser parser;
+                std::optional<BinaryDocument> document;
+                Measurement result = measure(repeat, [&] { document.reset(); }, [&] {
+                    document.emplace(parser.readBinary(binary));
+                    document->getRoot().size();
+                });
+                result.binaryBytes = binaryBytes;
+                result.items = 1;
+                return result;
+            }));
+            std::remove(binary.c_str());
+
+            // Construction from an existing tree, the source is not timed
+            const std::pair<const char*, std::function<JsonValue(const JsonValue&)>> constructions[] = {
+                {"constructCopy", [](const JsonValue& source) { return rebuild(source, false); }},
+                {"constructMove", [](const JsonValue& source) { return rebuild(source, true); }},
+                {"constructBuilder", [](const JsonValue& source) {
+                    JsonBuilder builder;
+                    replay(source, builder);
+                    return builder.takeResult();
+                }}
+            };
+            for (const auto& construction : constructions) {
+                report(corpus, bytes, construction.first, "node", isolated([&] {
+                    JsonParser parser;
+                    const JsonValue source = parser.readFromFile(filename);
+                    JsonValue value;
+                    Measurement result = measure(repeat, [&] { value = JsonValue(); }, [&] { value = construction.second(source); });
+                    result.items = countNodes(value);
+                    return result;
+                }));
+            }
+        }
+    }
+
+    return 0;
+}
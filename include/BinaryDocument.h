@@ -0,0 +1,105 @@
+#ifndef BINARYDOCUMENT_H
+#define BINARYDOCUMENT_H
+
+#include "JsonValue.h"
+#include "JsonDocument.h"
+#include "MappedFile.h"
+#include <string>
+#include <string_view>
+
+class BinaryDocument;
+
+
+// Handle to a value inside a BinaryDocument, read straight from the encoded bytes.
+// A handle is only valid as long as its document is alive and not moved.
+class BinaryValue {
+
+private:
+    const BinaryDocument* document;
+    std::size_t offset; // Position of the tag of the value
+
+public:
+
+    BinaryValue(const BinaryDocument* document, std::size_t offset) : document(document), offset(offset) {}
+
+    // holding types
+    bool isBool() const;
+    bool isNumber() const;
+    bool isInteger() const;
+    bool isUnsigned() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+    bool isNull() const;
+
+    // Getter methods, same rules as the ones of JsonValue
+    std::string_view getAsStringView() const; // the characters in the file, not copied
+    JsonValue::JsonString getAsString() const;
+    JsonValue::JsonNumber getAsNumber() const;
+    JsonValue::JsonInteger getAsInteger() const;
+    JsonValue::JsonUnsigned getAsUnsigned() const;
+    JsonValue::JsonBool getAsBool() const;
+
+    // Access Object && Access Array, every skipped member / element costs a size read
+    BinaryValue operator[](std::string_view str) const;
+    BinaryValue operator[](std::size_t idx) const;
+
+    // Walk a path of keys and indices
+    BinaryValue at(const JsonValue::pathInJson&) const;
+
+    // Number of members of an object or elements of an array
+    std::size_t size() const;
+
+    // Decode the whole subtree into a JsonValue
+    JsonValue materialize() const;
+
+private:
+
+    unsigned char tag() const;
+
+    // The scalar value, decoded
+    JsonValue scalar() const;
+};
+
+
+// A file holding one JsonValue in the binary encoding, mapped in memory and read on demand.
+//
+// Every value is a tag byte followed by its payload, integers are little endian:
+//   null, false, true    the tag alone
+//   double               8 bytes, IEEE 754
+//   integer / unsigned   zigzag / plain LEB128 varint
+//   string               varint byte length, then the bytes
+//   array / object       4 byte size of what follows, varint count, then the elements / members,
+//                        a member being its key (varint length and bytes) followed by its value
+// Containers carry their size, so any value is skipped in constant time without being decoded.
+class BinaryDocument {
+
+    friend class BinaryValue;
+
+private:
+    MappedFile file;
+
+public:
+
+    // Checks the header of the file
+    explicit BinaryDocument(MappedFile&& file);
+
+    BinaryValue getRoot() const;
+
+    // Append the encoding of the value, header included, to out
+    static void encode(const JsonValue&, std::string& out);
+
+    // Decode a whole encoding, e.g. the output of encode
+    static JsonValue decode(std::string_view);
+
+    // Same into the arena of a document, whose strings borrow from its copy of the input like the ones
+    // of JsonParser::parseDocument, and whose keys are interned
+    static JsonDocument decodeDocument(std::string_view);
+
+private:
+
+    // The encoded bytes after the header
+    std::string_view body() const;
+};
+
+#endif
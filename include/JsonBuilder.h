@@ -0,0 +1,90 @@
+#ifndef JSONBUILDER_H
+#define JSONBUILDER_H
+
+#include "JsonValue.h"
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+// Builds a JsonValue from a sequence of calls, as a parser would:
+//
+//     JsonBuilder builder;
+//     builder.beginObject().key("id").value(7).key("tags").beginArray().value("a").value("b").endArray().endObject();
+//     JsonValue value = builder.takeResult();
+//
+// Members and elements wait on two stacks shared by all the open containers, and each container is made
+// when it ends, with exactly the capacity it needs, its values being moved into it. Nothing is copied and
+// no container grows, whatever the depth. Strings, keys that do not fit inline and containers are allocated
+// from the resource given to the builder, e.g. the arena of a JsonDocument. Calls out of order throw.
+class JsonBuilder {
+
+private:
+    // Open container: its kind and where its members / elements start on the stacks
+    struct Frame {
+        bool isObject;
+        std::size_t base;
+    };
+
+    std::pmr::memory_resource* resource;
+
+    std::vector<Frame> frames;
+    std::vector<std::pair<JsonKey, JsonValue>> memberStack;
+    std::vector<JsonValue> valueStack;
+
+    // Whether the last member of the innermost object is a key waiting for its value. The key is put on the
+    // member stack when it comes and stays there while the members of a container value are built above it.
+    bool hasKey = false;
+
+    JsonValue result;
+    bool complete = false;
+
+public:
+
+    explicit JsonBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Containers, a value inside an object needs its key first. They return the builder so calls can be chained
+    JsonBuilder& beginObject();
+    JsonBuilder& endObject();
+    JsonBuilder& beginArray();
+    JsonBuilder& endArray();
+    JsonBuilder& key(std::string_view);
+
+    // Values, moved as they are or copied into the resource of the builder
+    JsonBuilder& value(JsonValue&&);
+    JsonBuilder& value(const JsonValue&);
+
+    // Scalars made in place, signed integers are kept as a JsonInteger and unsigned ones as a JsonUnsigned
+    JsonBuilder& value(std::string_view);
+    JsonBuilder& value(const char*);
+    JsonBuilder& value(JsonValue::JsonNumber);
+    JsonBuilder& value(JsonValue::JsonBool);
+    JsonBuilder& value(JsonValue::JsonNull);
+
+    template <typename Integer, typename = std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, bool>>>
+    JsonBuilder& value(Integer num) {
+        if constexpr (std::is_signed_v<Integer>) {
+            return value(JsonValue(JsonValue::JsonInteger(num)));
+        } else {
+            return value(JsonValue(JsonValue::JsonUnsigned(num)));
+        }
+    }
+
+    // Number of open containers
+    std::size_t depth() const { return frames.size(); }
+
+    // Whether a whole value was built
+    bool hasResult() const;
+
+    // The value built, the builder can be reused afterwards
+    JsonValue takeResult();
+
+    // Drop what was built so far
+    void reset();
+
+private:
+    void add(JsonValue&&);
+    void startContainer(bool isObject);
+};
+
+#endif
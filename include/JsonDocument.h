@@ -0,0 +1,80 @@
+#ifndef JSONDOCUMENT_H
+#define JSONDOCUMENT_H
+
+#include "JsonValue.h"
+#include "JsonKey.h"
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// Arena of a JsonDocument. It remembers the text copied into it, so that a borrowed string placed in a
+// container of another resource can tell that its characters would not outlive it, and one made an owned
+// string by getAsString() can stay in the arena of its document.
+class JsonArena : public std::pmr::monotonic_buffer_resource {
+
+private:
+    std::vector<std::pair<const char*, std::size_t>> texts;
+
+public:
+
+    explicit JsonArena(std::size_t initialSize);
+    ~JsonArena() override;
+
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+
+    // Copy text into the arena
+    char* storeText(std::string_view);
+
+    // Whether chars point into a text stored in the arena
+    bool holds(const char* chars) const;
+
+    // The live arena holding chars, null if none does
+    static JsonArena* holding(const char* chars);
+};
+
+
+// Owner of a parsed JSON tree whose nodes, strings and containers all live in one arena.
+// Allocation is a pointer bump and the whole arena is handed back at once when the document dies, without
+// walking the tree: whatever is put into it must come from getResource(), as the values added by
+// modifyJson, addToObject, addToArray and setRoot do, anything allocated elsewhere would never be freed.
+// A parsed document also keeps a copy of its input, which its string values borrow their text from,
+// and a table of its object keys, each distinct key being stored once for the whole document.
+class JsonDocument {
+
+private:
+    // Declared before root so it outlives the tree, kept behind a pointer so moves do not invalidate it
+    std::unique_ptr<JsonArena> arena;
+    JsonKeyTable keys;
+    JsonValue root;
+
+public:
+
+    // The size hint is the first block of the arena, e.g. the size of the input
+    explicit JsonDocument(std::size_t sizeHint = 0);
+
+    JsonDocument(JsonDocument&&) noexcept = default;
+    JsonDocument& operator=(JsonDocument&&) noexcept;
+    ~JsonDocument();
+
+    // The memory resource values of this document should be allocated from
+    std::pmr::memory_resource* getResource() const;
+
+    JsonValue& getRoot();
+    const JsonValue& getRoot() const;
+
+    // Replace the root, a value coming from another resource is copied into the arena
+    void setRoot(JsonValue&&);
+
+    // Interned keys of the document, they live as long as it does
+    JsonKeyTable& getKeyTable();
+
+    // Copy text into the arena, values of the document can then borrow from the copy. Borrowed strings moved
+    // by the pmr containers into another resource copy their characters there.
+    char* storeText(std::string_view);
+};
+
+#endif
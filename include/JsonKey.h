@@ -0,0 +1,128 @@
+#ifndef JSONKEY_H
+#define JSONKEY_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+// Key of an object member. Short keys are kept inside the key, longer ones are allocated from the
+// memory resource of the object, and interned keys share the characters and the hash of one entry
+// of a JsonKeyTable, so they take no memory of their own and equal keys compare by pointer.
+class JsonKey {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    static constexpr std::size_t inlineCapacity = 16;
+
+private:
+    enum class Storage : unsigned char {
+        Inline,
+        Allocated,
+        Shared
+    };
+
+    const char* chars;
+    std::uint32_t length;
+    Storage storage;
+    union {
+        char inlineChars[inlineCapacity];
+        std::pmr::memory_resource* resource; // Allocated: owner of the characters
+        struct {
+            std::size_t hash;                // Shared: computed once by the table
+            std::pmr::memory_resource* owner; // Shared: resource of the table holding the characters
+        } interned;
+    };
+
+public:
+
+    JsonKey() : chars(inlineChars), length(0), storage(Storage::Inline) {}
+
+    // Copy of the characters of any string, in the resource of alloc when they do not fit inline
+    template <typename String, typename = std::enable_if_t<!std::is_same_v<std::decay_t<String>, JsonKey>
+                                                           && std::is_convertible_v<const String&, std::string_view>>>
+    JsonKey(const String& key, const allocator_type& alloc = {}) : JsonKey() {
+        assign(std::string_view(key), alloc.resource());
+    }
+
+    // Copies own their characters, moves keep sharing them. Allocator-extended versions for the pmr containers,
+    // whose moves into another resource copy the characters of allocated and interned keys there.
+    JsonKey(const JsonKey& other) : JsonKey(other, allocator_type()) {}
+    JsonKey(const JsonKey& other, const allocator_type& alloc);
+    JsonKey(JsonKey&& other) noexcept;
+    JsonKey(JsonKey&& other, const allocator_type& alloc);
+    JsonKey& operator=(const JsonKey& other);
+    JsonKey& operator=(JsonKey&& other) noexcept;
+    ~JsonKey();
+
+    // Key referring to characters owned elsewhere that outlive it, hash must be hashOf(chars) and owner the
+    // resource they were allocated from
+    static JsonKey shared(std::string_view chars, std::size_t hash, std::pmr::memory_resource* owner);
+
+    std::string_view view() const { return std::string_view(chars, length); }
+    operator std::string_view() const { return view(); }
+
+    const char* data() const { return chars; }
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    // Whether the key is interned
+    bool isShared() const { return storage == Storage::Shared; }
+
+    // hashOf the key, not computed again for interned keys
+    std::size_t hash() const;
+    static std::size_t hashOf(std::string_view);
+
+    // Interned keys of the same table are equal when they point to the same characters
+    friend bool operator==(const JsonKey& a, const JsonKey& b) {
+        return (a.chars == b.chars && a.length == b.length) || a.view() == b.view();
+    }
+    friend bool operator!=(const JsonKey& a, const JsonKey& b) { return !(a == b); }
+    friend bool operator==(const JsonKey& a, std::string_view b) { return a.view() == b; }
+    friend bool operator!=(const JsonKey& a, std::string_view b) { return a.view() != b; }
+
+private:
+    void assign(std::string_view key, std::pmr::memory_resource* target);
+    void release();
+};
+
+
+// Interns the keys of a document: every distinct key is copied into the memory resource and hashed
+// once, then each occurrence is a shared JsonKey of that copy, valid as long as the table lives.
+class JsonKeyTable {
+
+private:
+    struct Slot {
+        const char* chars = nullptr; // null for an empty slot
+        std::uint32_t length = 0;
+        std::size_t hash = 0;
+    };
+
+    std::pmr::memory_resource* resource;
+
+    // Open addressing table, at most half full
+    std::vector<Slot> slots;
+    std::size_t count = 0;
+
+public:
+
+    explicit JsonKeyTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    JsonKeyTable(JsonKeyTable&&) noexcept;
+    JsonKeyTable& operator=(JsonKeyTable&&) noexcept;
+    ~JsonKeyTable();
+
+    // The shared key of the characters, stored on their first occurrence
+    JsonKey intern(std::string_view key);
+
+    // Number of distinct keys
+    std::size_t size() const { return count; }
+
+private:
+    void grow();
+    void release();
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef JSONOBJECT_H
+#define JSONOBJECT_H
+
+#include "JsonValue.h"
+#include "JsonKey.h"
+#include <utility>
+#include <cstdint>
+#include <vector>
+
+
+// Object storage of a JsonValue: the members are kept in insertion order in one flat array.
+// Small objects are searched linearly, a hash index over the array is only built once the
+// object grows past indexThreshold keys.
+class JsonObject {
+public:
+    using allocator_type = JsonValue::allocator_type;
+
+    // The key of a member must not be changed through an iterator
+    using value_type = std::pair<JsonKey, JsonValue>;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    static constexpr std::size_t indexThreshold = 16;
+
+private:
+    std::pmr::vector<value_type> members;
+
+    // Open addressing table of member positions + 1 (0 is an empty slot), empty below the threshold
+    std::pmr::vector<uint32_t> index;
+
+public:
+
+    JsonObject() = default;
+    explicit JsonObject(const allocator_type& alloc) : members(alloc), index(alloc) {}
+    JsonObject(const JsonObject& other, const allocator_type& alloc);
+    JsonObject(JsonObject&& other, const allocator_type& alloc);
+
+    JsonObject(const JsonObject&) = default;
+    JsonObject(JsonObject&&) noexcept = default;
+    JsonObject& operator=(const JsonObject&) = default;
+    JsonObject& operator=(JsonObject&&) = default;
+
+    allocator_type get_allocator() const;
+
+    // Iteration in insertion order
+    iterator begin() { return members.begin(); }
+    iterator end() { return members.end(); }
+    const_iterator begin() const { return members.begin(); }
+    const_iterator end() const { return members.end(); }
+
+    std::size_t size() const { return members.size(); }
+    bool empty() const { return members.empty(); }
+    void reserve(std::size_t count) { members.reserve(count); }
+
+    // Lookup, end() when the key is missing
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    bool contains(std::string_view key) const;
+
+    // Lookup with the hashKey of the key computed beforehand
+    iterator find(std::string_view key, std::size_t hash);
+    const_iterator find(std::string_view key, std::size_t hash) const;
+
+    // Hash of a key used by the index, the one JsonKey::hash() caches for interned keys
+    static std::size_t hashKey(std::string_view key);
+
+    // Value of the key, a null value is appended first if the key is missing
+    JsonValue& operator[](std::string_view key);
+
+    // Append the member, or replace the value when the key is already there
+    std::pair<iterator, bool> insert_or_assign(JsonKey&& key, JsonValue&& value);
+
+    // Insert a member before position, the key must not be in the object yet
+    iterator insert(const_iterator position, JsonKey&& key, JsonValue&& value);
+
+    // Remove the member, the order of the others is kept. Returns the number of removed members
+    std::size_t erase(std::string_view key);
+
+    // Remove the members of all the keys in one pass over the object, missing keys are skipped
+    std::size_t erase(const std::vector<std::string_view>& keys);
+
+    void clear();
+
+private:
+
+    std::size_t findPosition(std::string_view key) const;
+    std::size_t findPosition(std::string_view key, std::size_t hash) const;
+
+    // Same for a key that may be interned, its cached hash is used and equal interned keys match by address
+    std::size_t findPosition(const JsonKey& key) const;
+
+    // Add the member at position to the hash index, building or growing the index if needed
+    void indexMember(std::size_t position);
+
+    // Remove the member at position from the hash index, the positions of the others are not changed
+    void unindexMember(std::size_t position);
+    void rebuildIndex();
+};
+
+#endif
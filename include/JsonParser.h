@@ -2,59 +2,150 @@
 #define JSONPARSER_H
 
 #include "JsonValue.h"
+#include "JsonDocument.h"
+#include "LazyDocument.h"
+#include "BinaryDocument.h"
+#include "TapeDocument.h"
+#include "JsonSchema.h"
+#include "JsonWriter.h"
+#include "SourceMap.h"
 #include <vector>
 #include <iostream>
 #include <stdexcept>
+#include <string_view>
+#include <functional>
 
 
 class JsonParser {
 
-private:
-
-    enum class TokenType {
-        ObjectOpen, // {
-        ObjectClose, // }
-        ArrayOpen, // [
-        ArrayClose, // ]
-        String, // "Hello"
-        Number, // 3.5, 3, -3, 0, e, pi
-        True, // true
-        False, // false
-        Null, // null
-        Colon, // :
-        Comma // ,
-    };
-
-    struct Token {
-        TokenType type;
-        std::string value;
-    };
-
 public:
 
     // Main parsing function - Contains the starting state and the accepting state.
-    JsonValue parse(const std::vector<Token>&);
+    // The input is read once, from left to right, and the JsonValue is built on the way.
+    JsonValue parse(std::string_view);
 
     // Function to read JSON data from a file and parse it
     JsonValue readFromFile(const std::string&);
 
-    // Function to write a Json format to a file
-    void printToFile(const std::string&, const JsonValue&);
+    // Same as parse / readFromFile for one large document whose root is an array or an object. The input is
+    // cut into segments, the string state and nesting depth at each cut are worked out in parallel, then the
+    // root elements of every segment are parsed by their own thread and joined in order. Small inputs and
+    // other roots are parsed serially, and so is invalid input, so errors are the ones of parse.
+    JsonValue parseParallel(std::string_view, unsigned threads = 0);
+    JsonValue readFromFileParallel(const std::string&, unsigned threads = 0);
+
+    // Same as parse / readFromFile, but the whole tree is allocated from the arena of the returned document.
+    // The input is copied into the arena once and string values borrow their text from that copy, escape
+    // sequences being decoded in place, so strings are neither allocated nor copied again.
+    JsonDocument parseDocument(std::string_view);
+    JsonDocument readDocument(const std::string&);
+
+    // Parse a file holding one JSON document per line (NDJSON / JSON Lines), blank lines are skipped.
+    // The file is split into chunks on line breaks and the chunks are parsed by worker threads,
+    // one per core when threads is 0. The records are returned in file order.
+    std::vector<JsonValue> readLinesFromFile(const std::string&, unsigned threads = 0);
+
+    // Same, but the records are handed to the callback in file order as they are parsed, so only
+    // a few chunks of parsed records are held in memory at once
+    void readLinesFromFile(const std::string&, const std::function<void(JsonValue&&)>&, unsigned threads = 0);
+
+    // Same as parse / readFromFile for input that must follow a schema. The schema is checked on the events
+    // of a JsonStreamParser while the value is being built, so invalid input throws at the first value that
+    // breaks it and is never built whole
+    JsonValue parseValidated(std::string_view, const JsonSchema&);
+    JsonValue readValidated(const std::string&, const JsonSchema&);
+
+    // Map the file and index its structure only, values are parsed when they are reached
+    LazyDocument readLazy(const std::string&);
+
+    // Parse the file onto the flat tape of an immutable TapeDocument, for read-only lookups
+    TapeDocument readTape(const std::string&);
+
+    // Function to write a Json format to a file, the text is built in memory and written at once
+    void printToFile(const std::string&, const JsonValue&, JsonWriter::Style = JsonWriter::Style::Pretty);
+
+    // Same as readFromFile, recording in map where the containers are in the file and their hashes
+    JsonValue readWithSourceMap(const std::string&, SourceMap&);
+
+    // Write a value read with readWithSourceMap, and modified since, by rewriting only the parts of the
+    // file that changed: the text of untouched values is kept, with its formatting and key order. When the
+    // file is the source one and the changes fit, they are written in place. See SourceMap::write.
+    void printPatchedToFile(const std::string&, const JsonValue&, SourceMap&);
+
+    // Write the value in the binary encoding of BinaryDocument, which loads without any text parsing
+    void printBinaryToFile(const std::string&, const JsonValue&);
+
+    // Decode a whole binary file into a JsonValue, or into a document as readDocument does
+    JsonValue readBinaryFromFile(const std::string&);
+    JsonDocument readBinaryDocument(const std::string&);
+
+    // Map a binary file, values are read in place when they are reached
+    BinaryDocument readBinary(const std::string&);
+
+    // Value of a complete number / true / false / null literal
+    static JsonValue parseLiteral(std::string_view);
+
+    // Append the UTF-8 encoding of a unicode code point
+    static void appendUtf8(JsonValue::JsonString&, unsigned);
 
 private:
 
-    // Tokenize the JSON
-    static std::vector<Token> tokenizeJSONfile(std::ifstream&);
+    // Memory resource the containers and strings being parsed are allocated from
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+
+    // Writable copy of the input owned by the document being parsed, null otherwise
+    char* inSitu = nullptr;
+
+    // Key table of the document being parsed, object keys are interned when it is set
+    JsonKeyTable* keyTable = nullptr;
+
+    // Spans of the containers parsed, recorded when it is set
+    std::vector<SourceMap::Span>* spans = nullptr;
+
+    // Characters of the key being read, reused from one key to the next
+    JsonValue::JsonString keyBuffer;
+
+    // Elements and members of the containers being parsed, so each container is allocated once
+    std::vector<JsonValue> valueStack;
+    std::vector<std::pair<JsonKey, JsonValue>> memberStack;
+
+    // Parse the lines of input between begin and end, stop at the first error
+    struct LineChunk;
+    void parseLines(std::string_view input, LineChunk& chunk);
+
+    // Hand the records of a parsed chunk to the callback, then throw its error if any
+    static void deliverLines(std::string_view input, LineChunk& chunk, const std::function<void(JsonValue&&)>&);
+
+    // Parse the elements / members of the root container from index onto the stacks, up to and including
+    // the comma at boundary, or up to the closing bracket / brace when boundary is npos
+    void parseArrayRange(std::string_view input, size_t& index, size_t boundary);
+    void parseObjectRange(std::string_view input, size_t& index, size_t boundary);
+
+    // Skip the white spaces between two values / delimiters
+    static void skipWhitespace(std::string_view, size_t&);
 
     // Main transition Function
-    JsonValue parseValue(const std::vector<Token>&, size_t&);
+    JsonValue parseValue(std::string_view, size_t&);
 
     // Helper transition function to parse an Object inside an object
-    JsonValue::JsonObject parseObject(const std::vector<Token>&, size_t&);
+    JsonValue::JsonObject parseObject(std::string_view, size_t&);
 
     // Helper transition function to parse an array inside an object
-    JsonValue::JsonArray parseArray(const std::vector<Token>&, size_t&);
+    JsonValue::JsonArray parseArray(std::string_view, size_t&);
+
+    // Helper transition function to parse a string, the index points after the opening quote.
+    // The characters are appended to the given string.
+    void parseString(std::string_view, size_t&, JsonValue::JsonString&);
+
+    // Same, but the string is unescaped in the in situ copy of the input and a view of it is returned
+    std::string_view parseStringInSitu(std::string_view, size_t&);
+
+    // Parse the string of an object key, interned when parsing into a document
+    JsonKey parseKey(std::string_view, size_t&);
+
+    // Helper transition function to parse true, false, null and numbers
+    static JsonValue parseLiteral(std::string_view, size_t&);
 
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,80 @@
+#ifndef JSONPATCH_H
+#define JSONPATCH_H
+
+#include "JsonValue.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// A batch of edits applied to a JsonValue in one go, with the operations of RFC 6902 (JSON Patch).
+// Operations are applied in order, as if one by one, but the walk from the root is shared: each
+// operation starts from the deepest value its path has in common with the previous one, so
+// operations on the same subtree should come together (see sortByPath).
+class JsonPatch {
+
+public:
+    // Keys and indices from the root. A key made of digits can index an array, and "-" is the end
+    // of an array for add, as in a JSON Pointer.
+    using Path = JsonValue::pathInJson;
+
+    enum class Op {
+        Add,
+        Remove,
+        Replace,
+        Move,
+        Copy,
+        Test
+    };
+
+    struct Operation {
+        Op op;
+        Path path;
+        Path from;       // move and copy
+        JsonValue value; // add, replace and test
+    };
+
+private:
+    std::vector<Operation> operations;
+
+public:
+
+    JsonPatch() = default;
+
+    // From a JSON Patch document: an array of {"op", "path", "from", "value"} objects
+    explicit JsonPatch(const JsonValue& patch);
+
+    // Append an operation, they return the patch so calls can be chained
+    JsonPatch& add(Path path, JsonValue&& value);
+    JsonPatch& remove(Path path);
+    JsonPatch& replace(Path path, JsonValue&& value);
+    JsonPatch& move(Path from, Path path);
+    JsonPatch& copy(Path from, Path path);
+    JsonPatch& test(Path path, JsonValue&& value);
+
+    const std::vector<Operation>& getOperations() const;
+
+    // Sort every run of consecutive replace / test operations and removes of object members by path, so
+    // that a run is applied in one traversal and the members removed from one object come together, which
+    // apply removes in one pass over the object. The result is the same: a run is left as it is when one of
+    // its paths is inside another one. Adds and array removes keep their place, their order matters.
+    // Worth it for a patch applied to many documents, or with scattered deep paths.
+    JsonPatch& sortByPath();
+
+    // Apply every operation to target, throws at the first one that fails. When atomic, the
+    // operations already applied are undone first so target is left as it was. Consecutive removes of
+    // members of the same object are applied together, in one pass over the object.
+    void apply(JsonValue& target, bool atomic = true) const;
+
+    // Patch turning from into to: replace for changed values, add / remove for members and elements that
+    // appear or disappear. Subtrees are compared by JsonValue::hash() and skipped when their hashes match,
+    // so with the hashes cached, e.g. from a copy of the document that was hashed before being modified,
+    // the time depends on the changed paths rather than on the size of the documents.
+    static JsonPatch diff(const JsonValue& from, const JsonValue& to);
+
+    // "/a/0/b~1c" <-> {"a", "0", "b/c"}
+    static Path parsePointer(std::string_view pointer);
+    static std::string toPointer(const Path& path);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef JSONPATH_H
+#define JSONPATH_H
+
+#include "JsonValue.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// A path query compiled once, with its keys hashed, and evaluated against any number of values.
+// Supported subset of JSONPath:
+//   $                      the root, may be left out
+//   .key  ['key']  ["key"] member of an object
+//   [3]                    element of an array
+//   .*  [*]                every member / element
+//   ..key  ..*  ..[3]      the same at any depth below
+// e.g. "$.books[*].authors..name". Matches are pointers into the tree, in the order of the tree
+// (for "..", the matching children of a value come before the matches further below).
+// Missing keys and indices just match nothing, the tree is never modified. The non-const overloads walk it
+// through non-const access, which clears the cached hashes of the containers walked (see JsonValue::hash),
+// so the matches can be modified through the pointers returned.
+class JsonPath {
+
+private:
+
+    struct Step {
+        enum class Kind {
+            Key,
+            Index,
+            Wildcard
+        };
+
+        Kind kind;
+        bool recursive;       // preceded by ".."
+        std::string key;
+        std::size_t hash = 0; // JsonObject::hashKey of the key
+        std::size_t index = 0;
+    };
+
+    std::vector<Step> steps;
+
+public:
+
+    // Throws if the expression is not in the supported subset
+    explicit JsonPath(std::string_view expression);
+
+    // The keys and indices of a pathInJson, as used by modifyJson
+    explicit JsonPath(const JsonValue::pathInJson& path);
+
+    // Every value the path leads to, nothing is copied
+    std::vector<JsonValue*> select(JsonValue& root) const;
+    std::vector<const JsonValue*> select(const JsonValue& root) const;
+
+    // First value the path leads to, nullptr if none. The walk stops at the first match
+    JsonValue* selectFirst(JsonValue& root) const;
+    const JsonValue* selectFirst(const JsonValue& root) const;
+
+    // Whether a value at the given location is matched, e.g. as the selector of a JsonSubtreeCollector
+    bool matches(const JsonValue::pathInJson& path) const;
+
+private:
+
+    // Call visit for every match of the steps from step on below node, stop as soon as visit returns false.
+    // Value is JsonValue or const JsonValue.
+    template <typename Value, typename Visit>
+    bool evaluate(std::size_t step, Value& node, Visit& visit) const;
+    template <typename Value, typename Visit>
+    bool applyStep(std::size_t step, Value& node, Visit& visit) const;
+    template <typename Value, typename Visit>
+    bool descend(std::size_t step, Value& node, Visit& visit) const;
+
+    bool matchFrom(std::size_t step, std::size_t position, const JsonValue::pathInJson& path) const;
+};
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef JSONSCHEMA_H
+#define JSONSCHEMA_H
+
+#include "JsonValue.h"
+#include "JsonStreamParser.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// A JSON Schema compiled once into a table of nodes, each subschema being one node and every property
+// name being hashed into the key table of its object node. Supported subset of draft 2020-12:
+//   true / false                                   boolean schemas
+//   type                                           a name or an array of names
+//   enum  const                                    scalar values only
+//   minimum  maximum  exclusiveMinimum  exclusiveMaximum  multipleOf
+//   minLength  maxLength                           in code points
+//   properties  required  additionalProperties  minProperties  maxProperties
+//   prefixItems  items  minItems  maxItems
+//   $ref  $defs  definitions                       references inside the schema, "#" or "#/json/pointer"
+// Annotations ($schema, $id, title, description, default, ...) and unknown keywords are ignored.
+// Keywords that need more than one pass over a value (allOf, anyOf, oneOf, not, if, pattern,
+// patternProperties, uniqueItems, ...) are not supported and make the constructor throw.
+class JsonSchema {
+
+    friend class JsonSchemaValidator;
+
+private:
+
+    // Node 0 accepts everything and node 1 nothing
+    static constexpr std::uint32_t anyNode = 0;
+    static constexpr std::uint32_t noNode = 1;
+
+    // Bits of the accepted types
+    enum Type : unsigned {
+        NullType = 1,
+        BoolType = 2,
+        IntegerType = 4, // any number with no fractional part
+        NumberType = 8,
+        StringType = 16,
+        ArrayType = 32,
+        ObjectType = 64,
+        AnyType = 127
+    };
+
+    struct Property {
+        std::string name;
+        std::uint32_t node;
+        std::int32_t required; // position in the required keys of the object, -1 if optional
+    };
+
+    struct Node {
+        unsigned types = AnyType;
+
+        // Numbers
+        bool hasMinimum = false, hasMaximum = false, exclusiveMinimum = false, exclusiveMaximum = false;
+        bool hasMultipleOf = false;
+        JsonValue minimum, maximum, multipleOf; // as written, so that integers are compared exactly
+
+        // Strings
+        std::size_t minLength = 0, maxLength = SIZE_MAX;
+
+        // Scalar values the value must be one of, when hasEnum
+        bool hasEnum = false;
+        std::vector<JsonValue> enumValues;
+
+        // Objects: the properties, their key table (indices into properties + 1, 0 when empty)
+        // and the node of the members that are not listed
+        std::vector<Property> properties;
+        std::vector<std::uint32_t> keyTable;
+        std::uint32_t additional = anyNode;
+        std::size_t requiredCount = 0, minProperties = 0, maxProperties = SIZE_MAX;
+
+        // Arrays: the nodes of the first elements, then the node of the others
+        std::vector<std::uint32_t> prefixItems;
+        std::uint32_t items = anyNode;
+        std::size_t minItems = 0, maxItems = SIZE_MAX;
+    };
+
+    std::vector<Node> nodes;
+    std::uint32_t root = anyNode;
+
+public:
+
+    // Throws if the schema is not valid or uses a keyword outside the supported subset
+    explicit JsonSchema(const JsonValue& schema);
+
+    // Check a parsed value, throws at the first violation with the JSON pointer of the value
+    void validate(const JsonValue&) const;
+
+    // Check JSON text without building it, throws at the first violation or syntax error
+    void validate(std::string_view) const;
+
+    // Whether the value / text is valid
+    bool isValid(const JsonValue&) const;
+    bool isValid(std::string_view) const;
+
+private:
+
+    class Compiler;
+
+    // Property named key looked up in the key table of node, nullptr if it is not listed
+    const Property* findProperty(const Node& node, std::string_view key) const;
+};
+
+
+// Checks the events of a JsonStreamParser against a schema as they come, each event being passed on to
+// the next handler once checked. The first event that breaks the schema throws, so parsing stops right
+// there and the next handler never sees the value, e.g. a JsonValueBuilder never builds an invalid tree.
+// The schema must outlive the validator.
+class JsonSchemaValidator : public JsonHandler {
+
+private:
+
+    struct Frame {
+        std::uint32_t node;
+        bool isObject;
+        std::size_t count = 0;           // members or elements so far
+        std::uint32_t child = 0;         // node of the value of the current member
+        std::string key;                 // name of the current member, for error messages
+        std::vector<bool> seenRequired;
+    };
+
+    const JsonSchema& schema;
+    JsonHandler* next;
+
+    // Open containers, frames past depth are kept to reuse their buffers
+    std::vector<Frame> frames;
+    std::size_t depth = 0;
+
+public:
+
+    explicit JsonSchemaValidator(const JsonSchema& schema, JsonHandler* next = nullptr);
+
+    void startObject() override;
+    void key(std::string_view) override;
+    void endObject() override;
+    void startArray() override;
+    void endArray() override;
+    void string(std::string_view) override;
+    void number(JsonValue::JsonNumber) override;
+    void integer(JsonValue::JsonInteger) override;
+    void unsignedInteger(JsonValue::JsonUnsigned) override;
+    void boolean(JsonValue::JsonBool) override;
+    void null() override;
+
+    // Start over with a new document
+    void reset();
+
+private:
+
+    // Node of the value that starts, which is counted as an element of the enclosing array
+    std::uint32_t beginValue();
+    void checkType(const JsonSchema::Node&, unsigned type, const char* name);
+    void checkNumber(const JsonSchema::Node&, const JsonValue& value);
+    void checkEnum(const JsonSchema::Node&, const std::function<bool(const JsonValue&)>& equals);
+    void startContainer(std::uint32_t node, bool isObject);
+
+    // Throws with the JSON pointer of the value inside the first levels open containers
+    [[noreturn]] void fail(const std::string& message, std::size_t levels) const;
+    [[noreturn]] void fail(const std::string& message) const;
+};
+
+#endif
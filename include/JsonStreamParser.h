@@ -0,0 +1,209 @@
+#ifndef JSONSTREAMPARSER_H
+#define JSONSTREAMPARSER_H
+
+#include "JsonValue.h"
+#include "JsonBuilder.h"
+#include <functional>
+#include <istream>
+#include <vector>
+
+
+// Receiver of the events of a JsonStreamParser, every method does nothing by default.
+// The views passed to key and string are only valid during the call. Integer literals are
+// reported through integer / unsignedInteger, which fall back to number unless overridden.
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+
+    virtual void startObject() {}
+    virtual void key(std::string_view) {}
+    virtual void endObject() {}
+    virtual void startArray() {}
+    virtual void endArray() {}
+    virtual void string(std::string_view) {}
+    virtual void number(JsonValue::JsonNumber) {}
+    virtual void integer(JsonValue::JsonInteger num) { number(JsonValue::JsonNumber(num)); }
+    virtual void unsignedInteger(JsonValue::JsonUnsigned num) { number(JsonValue::JsonNumber(num)); }
+    virtual void boolean(JsonValue::JsonBool) {}
+    virtual void null() {}
+};
+
+
+// Push parser turning JSON text into JsonHandler events. The input can be given in chunks of
+// any size, split anywhere, and the parser only keeps its nesting stack and the token being read,
+// so the memory used does not depend on the size of the document.
+class JsonStreamParser {
+
+private:
+
+    enum class State {
+        Value,       // a value is expected (the root or after a colon)
+        ArrayNext,   // inside an array: a value or the closing bracket
+        ObjectNext,  // inside an object: a key or the closing brace
+        Colon,       // after a key
+        String,      // inside a string or key
+        Escape,      // after a backslash inside a string
+        Unicode,     // reading the 4 hex digits of a \u escape
+        Literal,     // inside a number / true / false / null
+        Done         // after the root value, only white space may follow
+    };
+
+    JsonHandler& handler;
+    State state = State::Value;
+
+    // '{' or '[' for every open container
+    std::vector<char> nesting;
+
+    // Whether a comma may come next in the innermost container: a value ended and no comma followed it yet.
+    // As for JsonParser::parse, a comma cannot open a container nor follow another one.
+    bool commaAllowed = false;
+
+    // The string, key or literal being read
+    JsonValue::JsonString token;
+    bool tokenIsKey = false;
+    unsigned unicodeCode = 0;
+    int unicodeDigits = 0;
+    unsigned highSurrogate = 0; // first half of a surrogate pair waiting for its second half
+
+public:
+
+    explicit JsonStreamParser(JsonHandler& handler);
+
+    // Parse the next chunk of the input
+    void feed(const char* data, std::size_t size);
+    void feed(std::string_view chunk);
+
+    // End of the input, throws if the document is not complete
+    void finish();
+
+    // Start over with a new document
+    void reset();
+
+    // Read the whole stream in chunks of chunkSize bytes
+    static void parseStream(std::istream&, JsonHandler&, std::size_t chunkSize = 1 << 16);
+    static void parseFile(const std::string&, JsonHandler&, std::size_t chunkSize = 1 << 16);
+
+    // Read a file descriptor (pipe, socket, ...) until end of file. Whatever each read returns is parsed
+    // right away instead of waiting for a full chunk, so parsing keeps up with the producer.
+    static void parseDescriptor(int fd, JsonHandler&, std::size_t chunkSize = 1 << 16);
+
+private:
+
+    // Start a value with its first character
+    void startValue(char c);
+    void afterValue();
+    void endContainer(char close);
+    void emitLiteral();
+    void emitString();
+    void flushSurrogate();
+
+    // Handle one escaped character
+    void escape(char c);
+};
+
+
+// Builds a JsonValue from the events it receives, through a JsonBuilder
+class JsonValueBuilder : public JsonHandler {
+
+private:
+    JsonBuilder builder;
+
+public:
+
+    explicit JsonValueBuilder(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    void startObject() override;
+    void key(std::string_view) override;
+    void endObject() override;
+    void startArray() override;
+    void endArray() override;
+    void string(std::string_view) override;
+    void number(JsonValue::JsonNumber) override;
+    void integer(JsonValue::JsonInteger) override;
+    void unsignedInteger(JsonValue::JsonUnsigned) override;
+    void boolean(JsonValue::JsonBool) override;
+    void null() override;
+
+    // Whether a whole value was received
+    bool hasResult() const;
+
+    // The value built, the builder can be reused afterwards
+    JsonValue takeResult();
+};
+
+
+// Resumable parser building one JsonValue from input that arrives in pieces, e.g. from a socket.
+// Each piece is parsed when it is fed, partial strings, escapes, numbers and the nesting being kept
+// in between, so the value is ready as soon as the last piece is in.
+class JsonIncrementalParser {
+
+private:
+    JsonValueBuilder builder;
+    JsonStreamParser parser;
+
+public:
+
+    JsonIncrementalParser();
+
+    // The parser refers to the builder, neither can be moved
+    JsonIncrementalParser(const JsonIncrementalParser&) = delete;
+    JsonIncrementalParser& operator=(const JsonIncrementalParser&) = delete;
+
+    void feed(const char* data, std::size_t size);
+    void feed(std::string_view chunk);
+
+    // End of the input, returns the value and gets ready for the next document.
+    // Throws if the document is not complete, call reset() after any error.
+    JsonValue finish();
+
+    void reset();
+
+    // Read a file descriptor until end of file, see JsonStreamParser::parseDescriptor
+    static JsonValue readDescriptor(int fd, std::size_t chunkSize = 1 << 16);
+};
+
+
+// Follows the path of the events and builds a JsonValue only for the subtrees whose path is
+// selected, everything else is skipped. Each subtree is handed over as soon as it is complete.
+class JsonSubtreeCollector : public JsonHandler {
+
+public:
+    using Selector = std::function<bool(const JsonValue::pathInJson&)>;
+    using Receiver = std::function<void(const JsonValue::pathInJson&, JsonValue&&)>;
+
+private:
+    Selector select;
+    Receiver receive;
+
+    // Path of the next value, and the next index of every open array (SIZE_MAX for objects)
+    JsonValue::pathInJson path;
+    std::vector<std::size_t> nextIndex;
+
+    // Depth inside the subtree being built, 0 when nothing is being built
+    std::size_t captureDepth = 0;
+    JsonValueBuilder builder;
+
+public:
+
+    JsonSubtreeCollector(Selector select, Receiver receive);
+
+    void startObject() override;
+    void key(std::string_view) override;
+    void endObject() override;
+    void startArray() override;
+    void endArray() override;
+    void string(std::string_view) override;
+    void number(JsonValue::JsonNumber) override;
+    void integer(JsonValue::JsonInteger) override;
+    void unsignedInteger(JsonValue::JsonUnsigned) override;
+    void boolean(JsonValue::JsonBool) override;
+    void null() override;
+
+private:
+
+    // Called before every value, returns true when the value is captured
+    bool beginValue();
+    void endCapture();
+};
+
+#endif
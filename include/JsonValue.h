@@ -2,40 +2,114 @@
 #define JSONVALUE_H
 
 #include <variant>
-#include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <memory_resource>
+
+class JsonObject;
 
 class JsonValue {
 public:
-	using JsonObject = std::unordered_map<std::string, JsonValue>;
-	using JsonArray = std::vector<JsonValue>;
-	using JsonString = std::string;
+	// Containers take their memory from a std::pmr::memory_resource, the heap unless the value
+	// belongs to a JsonDocument arena. Values inserted into a container follow its resource.
+	using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+	using JsonObject = ::JsonObject; // Insertion ordered, see JsonObject.h
+	using JsonArray = std::pmr::vector<JsonValue>;
+	using JsonString = std::pmr::string;
 	using JsonNumber = double;
+	using JsonInteger = std::int64_t;   // Integer literals are kept exact, see isInteger()
+	using JsonUnsigned = std::uint64_t; // and isUnsigned()
 	using JsonBool = bool;
 	using JsonNull = std::nullptr_t;
     using pathInJson = std::vector<std::variant<std::size_t, std::string>>;
 
 private:
-	using ValueType = std::variant<JsonObject, JsonArray, JsonString, JsonNumber, JsonBool, JsonNull>;
-    ValueType value;
+	// Tag of the value held by the node
+	enum class Type : unsigned char {
+		Null,
+		Bool,
+		Number,
+		Integer,
+		Unsigned,
+		String,
+		Borrowed, // string whose characters belong to someone else, see borrowed()
+		Array,
+		Object
+	};
+
+	// Container stored out of line next to the cached hash of its subtree, see hash()
+	template <typename T>
+	struct Stored;
+
+	// Scalars live inside the node, strings and containers out of line in the memory
+	// resource they were built with, so a node is 16 bytes whatever it holds.
+	union Payload {
+		JsonNumber number;
+		JsonInteger integer;
+		JsonUnsigned unsignedInteger;
+		JsonBool boolean;
+		JsonString* string;
+		const char* borrowed;
+		Stored<JsonArray>* array;
+		Stored<JsonObject>* object;
+	};
+
+	// Mutable as a borrowed string becomes an owned one when it is asked for as a JsonString.
+	// The length of a borrowed string fits in the padding of the node.
+	mutable Payload payload;
+	mutable Type type;
+	std::uint32_t borrowedSize = 0;
 
 public:
 
 	// Constructors for different JSON data types
-	JsonValue() : value(JsonNull{}) {}
-	explicit JsonValue(const JsonObject& obj) : value(obj) {}
-	explicit JsonValue(const JsonArray& arr) : value(arr) {}
-	explicit JsonValue(const JsonString& str) : value(str) {}
-	explicit JsonValue(JsonNumber num) : value(num) {}
-	explicit JsonValue(JsonBool b) : value(b) {}
-	explicit JsonValue(JsonNull) : value(nullptr) {}
+	JsonValue() : type(Type::Null) { payload.object = nullptr; }
+	explicit JsonValue(const JsonObject& obj);
+	explicit JsonValue(const JsonArray& arr);
+	explicit JsonValue(const JsonString& str);
+	explicit JsonValue(JsonNumber num) : type(Type::Number) { payload.number = num; }
+	explicit JsonValue(JsonInteger num) : type(Type::Integer) { payload.integer = num; }
+	explicit JsonValue(JsonUnsigned num) : type(Type::Unsigned) { payload.unsignedInteger = num; }
+	explicit JsonValue(JsonBool b) : type(Type::Bool) { payload.boolean = b; }
+	explicit JsonValue(JsonNull) : JsonValue() {}
+
+	// Take over containers built by the caller, e.g. in an arena, without copying them
+	explicit JsonValue(JsonObject&& obj);
+	explicit JsonValue(JsonArray&& arr);
+	explicit JsonValue(JsonString&& str);
+
+	// String referring to characters owned elsewhere, e.g. the input kept by a JsonDocument, that must
+	// outlive the value. Moves keep referring to them, copies and getAsString() make an owned string,
+	// so concurrent readers of a shared value should use getAsStringView() instead. The pmr containers
+	// place their elements with the allocator-extended move, which also makes an owned string in the
+	// target resource unless it is the JsonDocument arena holding the characters.
+	static JsonValue borrowed(std::string_view str);
+
+	// Allocator-extended constructors, used by the pmr containers to place their elements
+	explicit JsonValue(const allocator_type&) : JsonValue() {}
+	JsonValue(const JsonValue& other, const allocator_type& alloc);
+	JsonValue(JsonValue&& other, const allocator_type& alloc);
+
+	// Copies go to the default resource, moves keep the resource of the source
+	JsonValue(const JsonValue&);
+	JsonValue(JsonValue&&) noexcept;
+	JsonValue& operator=(const JsonValue&);
+	JsonValue& operator=(JsonValue&&) noexcept;
+	~JsonValue();
+
+    // Allocator of the out of line storage, the default one for scalars
+    allocator_type getAllocator() const;
 
     // holding types
     bool isBool() const;
-    bool isNumber() const;
+    bool isNumber() const;   // any number, integers included
+    bool isInteger() const;  // held as a JsonInteger
+    bool isUnsigned() const; // held as a JsonUnsigned, the parser only uses it above the JsonInteger range
     bool isString() const;
     bool isArray() const;
     bool isObject() const;
@@ -45,7 +119,10 @@ public:
      const JsonObject& getAsObject() const;
      const JsonArray& getAsArray() const;
      const JsonString& getAsString() const;
+     std::string_view getAsStringView() const; // never copies, owned and borrowed strings alike
      JsonNumber getAsNumber() const;
+     JsonInteger getAsInteger() const;   // throws if the value is not an integer in range
+     JsonUnsigned getAsUnsigned() const; // same, negative integers are rejected
      JsonBool getAsBool() const;
 
     JsonObject& getAsObject();
@@ -53,13 +130,34 @@ public:
     JsonString& getAsString();
 
     // Access Object && Access Array
-    JsonValue& operator[](const JsonString& str);
+    JsonValue& operator[](std::string_view str);
     JsonValue& operator[](std::size_t idx);
 
     // Read
-    const JsonValue& operator[](const JsonString& str) const;
+    const JsonValue& operator[](std::string_view str) const;
     const JsonValue& operator[](std::size_t idx) const;
 
+    // Structural equality: members compare whatever their order, numbers by value whatever their
+    // representation (1, 1u and 1.0 are equal). Containers whose hashes are both cached and differ are
+    // told apart without being walked.
+    bool operator==(const JsonValue& other) const;
+    bool operator!=(const JsonValue& other) const;
+
+    // 64-bit hash of the subtree, equal values have equal hashes. It is computed once per container and
+    // kept next to it, copies keep it, and any non-const access to the container (getAsObject, getAsArray,
+    // operator[], modifyJson, addToObject, addToArray) clears it, so walking down to a value to change it
+    // clears the hashes of all its ancestors. A reference to a container taken before hash() must not be
+    // used to modify it afterwards. Like getAsString(), computing it writes to the value, so do it before
+    // sharing the value between threads.
+    std::uint64_t hash() const;
+
+    // hash() when it is known without walking the subtree: the cached one of a container, 0 when it is not cached
+    std::uint64_t cachedHash() const;
+
+    // Drop the hash cached by a container, for a hash() that must not be trusted after references into it
+    // were handed out, e.g. the ones JsonPath::select returned before a SourceMap save
+    void clearCachedHash() const;
+
     // Modify elements in the data
     void modifyJson(const pathInJson&, JsonValue&&, bool);
     void addToObject( const pathInJson&, const std::string&, JsonValue&&);
@@ -70,6 +168,23 @@ public:
 
     // TODO
     // OTHER METHODS CAN BE ADDED
+
+private:
+
+    // Deep copy of other with its containers and strings allocated from resource
+    void copyFrom(const JsonValue& other, std::pmr::memory_resource* resource);
+
+    // Free the out of line storage and become null
+    void release();
+
+    // Turn a borrowed string into an owned one, in the arena of the document holding its characters if any
+    void ownString() const;
+
+    // Become null without freeing anything, for a tree whose storage an arena releases as a whole
+    friend class JsonDocument;
+    void abandon();
 };
 
+#include "JsonObject.h"
+
 #endif
@@ -0,0 +1,54 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include "JsonValue.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+// Serializes JsonValues into a growable character buffer, the buffer can be reused between values.
+// Strings are escaped, doubles use the shortest text that reads back to the same value.
+class JsonWriter {
+
+public:
+
+    enum class Style {
+        Compact, // no white space at all
+        Pretty   // one member / element per line, indented by two spaces, as readablePrint
+    };
+
+private:
+    Style style;
+    std::string buffer;
+
+public:
+
+    explicit JsonWriter(Style style = Style::Compact) : style(style) {}
+
+    // Append the text of the value, indent is the nesting level it starts at
+    void write(const JsonValue& value, int indent = 0);
+
+    // Text written so far
+    std::string_view view() const { return buffer; }
+
+    // Forget the text but keep the memory of the buffer
+    void clear() { buffer.clear(); }
+
+    // Write the buffer to the stream at once and clear it
+    void flush(std::ostream& os);
+
+    // Text of one value
+    static std::string toString(const JsonValue& value, Style style = Style::Compact);
+
+private:
+
+    void writeValue(const JsonValue& value, int indent);
+    void writeString(std::string_view str);
+    void writeNumber(JsonValue::JsonNumber num);
+
+    // Line break followed by the indentation of the given nesting level, pretty style only
+    void newLine(int indent);
+};
+
+#endif
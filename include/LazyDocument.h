@@ -0,0 +1,92 @@
+#ifndef LAZYDOCUMENT_H
+#define LAZYDOCUMENT_H
+
+#include "JsonValue.h"
+#include "MappedFile.h"
+#include <vector>
+#include <cstdint>
+
+class LazyDocument;
+
+
+// Handle to a value inside a LazyDocument. Nothing is parsed until a getter or materialize()
+// reaches the value, subtrees that are walked over are skipped on the structural index.
+// A handle is only valid as long as its document is alive and not moved.
+class LazyValue {
+
+private:
+    const LazyDocument* document;
+    std::size_t entry; // Position of the first structural of the value in the index
+
+public:
+
+    LazyValue(const LazyDocument* document, std::size_t entry) : document(document), entry(entry) {}
+
+    // holding types
+    bool isBool() const;
+    bool isNumber() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+    bool isNull() const;
+
+    // Getter methods, the value is parsed on each call
+    JsonValue::JsonString getAsString() const;
+    JsonValue::JsonNumber getAsNumber() const;
+    JsonValue::JsonInteger getAsInteger() const;
+    JsonValue::JsonUnsigned getAsUnsigned() const;
+    JsonValue::JsonBool getAsBool() const;
+
+    // Access Object && Access Array, the skipped members are not parsed
+    LazyValue operator[](std::string_view str) const;
+    LazyValue operator[](std::size_t idx) const;
+
+    // Walk a path of keys and indices
+    LazyValue at(const JsonValue::pathInJson&) const;
+
+    // Number of members of an object or elements of an array
+    std::size_t size() const;
+
+    // Parse the whole subtree into a JsonValue
+    JsonValue materialize() const;
+
+    // The text of the value in the input
+    std::string_view raw() const;
+
+private:
+
+    char firstChar() const;
+};
+
+
+// A file mapped in memory with its structural index, values are materialized on demand.
+class LazyDocument {
+
+    friend class LazyValue;
+
+private:
+    MappedFile file;
+    std::vector<uint32_t> positions;
+
+public:
+
+    explicit LazyDocument(MappedFile&& file);
+
+    LazyValue getRoot() const;
+
+private:
+
+    // Character at the given index entry
+    char at(std::size_t entry) const;
+
+    // Index entry just past the value starting at entry
+    std::size_t skipValue(std::size_t entry) const;
+
+    // Bytes of the value starting at entry
+    std::string_view span(std::size_t entry) const;
+
+    // Whether the key string at entry (followed by its colon) equals key
+    bool keyEquals(std::size_t entry, std::string_view key) const;
+};
+
+#endif
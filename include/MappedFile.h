@@ -0,0 +1,42 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+
+// Read-only view of a whole file as one contiguous buffer.
+// On POSIX systems the file is memory-mapped, elsewhere it is read with a single bulk read.
+class MappedFile {
+
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+
+    // Fallback storage when the file could not be mapped
+    std::string buffer;
+
+public:
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+
+    // The content of the file
+    std::string_view view() const;
+    std::size_t size() const;
+
+private:
+
+    void release();
+    void readWhole(const std::string& filename);
+};
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef PERSISTENTDOCUMENT_H
+#define PERSISTENTDOCUMENT_H
+
+#include "JsonValue.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// Immutable sequence stored in a tree of nodes of up to 32 entries, the leaves holding the values in order.
+// set and push_back return a new sequence that copies the nodes from the root down to the changed entry and
+// shares all the other ones, so both cost O(log32 n) whatever the length, and the old sequence is unchanged.
+template <typename T>
+class PersistentVector {
+
+private:
+    static constexpr unsigned bits = 5;
+    static constexpr std::size_t width = std::size_t(1) << bits;
+    static constexpr std::size_t mask = width - 1;
+
+    // Leaves use values and branches children. Every leaf but the last one is full.
+    struct Node {
+        std::vector<T> values;
+        std::vector<std::shared_ptr<const Node>> children;
+    };
+
+    std::shared_ptr<const Node> root;
+    std::size_t count = 0;
+    unsigned shift = 0; // bits of the position below the root, 0 when the root is a leaf
+
+public:
+
+    class iterator {
+        const PersistentVector* sequence;
+        std::size_t position;
+        const T* leaf = nullptr; // values of the leaf holding position
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator(const PersistentVector* sequence, std::size_t position) : sequence(sequence), position(position) {
+            if (position < sequence->count) {
+                leaf = sequence->leafOf(position);
+            }
+        }
+
+        const T& operator*() const { return leaf[position & mask]; }
+        const T* operator->() const { return &leaf[position & mask]; }
+        iterator& operator++() {
+            if ((++position & mask) == 0 && position < sequence->count) {
+                leaf = sequence->leafOf(position);
+            }
+            return *this;
+        }
+        iterator operator++(int) { iterator previous = *this; ++*this; return previous; }
+        bool operator==(const iterator& other) const { return position == other.position; }
+        bool operator!=(const iterator& other) const { return position != other.position; }
+    };
+
+    PersistentVector() = default;
+
+    // All the values at once, the tree being built bottom-up
+    explicit PersistentVector(std::vector<T>&& values) : count(values.size()) {
+        if (values.empty()) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<const Node>> level;
+        for (std::size_t i = 0; i < count; i += width) {
+            auto leaf = std::make_shared<Node>();
+            leaf->values.assign(std::make_move_iterator(values.begin() + std::ptrdiff_t(i)),
+                                std::make_move_iterator(values.begin() + std::ptrdiff_t(std::min(i + width, count))));
+            level.push_back(std::move(leaf));
+        }
+        while (level.size() > 1) {
+            std::vector<std::shared_ptr<const Node>> parents;
+            for (std::size_t i = 0; i < level.size(); i += width) {
+                auto branch = std::make_shared<Node>();
+                branch->children.assign(std::make_move_iterator(level.begin() + std::ptrdiff_t(i)),
+                                        std::make_move_iterator(level.begin() + std::ptrdiff_t(std::min(i + width, level.size()))));
+                parents.push_back(std::move(branch));
+            }
+            level = std::move(parents);
+            shift += bits;
+        }
+        root = std::move(level.front());
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // No bounds check
+    const T& operator[](std::size_t position) const { return leafOf(position)[position & mask]; }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, count); }
+
+    // Copy with the value at position replaced
+    PersistentVector set(std::size_t position, T value) const {
+        PersistentVector result = *this;
+        result.root = setIn(*root, shift, position, std::move(value));
+        return result;
+    }
+
+    // Copy with the value appended, the tree gets one level higher when it is full
+    PersistentVector push_back(T value) const {
+        PersistentVector result = *this;
+        result.count = count + 1;
+        if (!root) {
+            result.root = pathTo(0, std::move(value));
+        } else if (count == width << shift) {
+            auto branch = std::make_shared<Node>();
+            branch->children.push_back(root);
+            branch->children.push_back(pathTo(shift, std::move(value)));
+            result.root = std::move(branch);
+            result.shift = shift + bits;
+        } else {
+            result.root = pushIn(*root, shift, count, std::move(value));
+        }
+        return result;
+    }
+
+private:
+
+    const T* leafOf(std::size_t position) const {
+        const Node* node = root.get();
+        for (unsigned level = shift; level > 0; level -= bits) {
+            node = node->children[(position >> level) & mask].get();
+        }
+        return node->values.data();
+    }
+
+    static std::shared_ptr<const Node> setIn(const Node& node, unsigned level, std::size_t position, T&& value) {
+        auto copy = std::make_shared<Node>(node);
+        if (level == 0) {
+            copy->values[position & mask] = std::move(value);
+        } else {
+            auto& child = copy->children[(position >> level) & mask];
+            child = setIn(*child, level - bits, position, std::move(value));
+        }
+        return copy;
+    }
+
+    static std::shared_ptr<const Node> pushIn(const Node& node, unsigned level, std::size_t position, T&& value) {
+        auto copy = std::make_shared<Node>(node);
+        if (level == 0) {
+            copy->values.push_back(std::move(value));
+        } else if (((position >> level) & mask) < copy->children.size()) {
+            auto& child = copy->children[(position >> level) & mask];
+            child = pushIn(*child, level - bits, position, std::move(value));
+        } else {
+            copy->children.push_back(pathTo(level - bits, std::move(value)));
+        }
+        return copy;
+    }
+
+    // New leaf holding value under level bits of branches
+    static std::shared_ptr<const Node> pathTo(unsigned level, T&& value) {
+        auto leaf = std::make_shared<Node>();
+        leaf->values.push_back(std::move(value));
+        std::shared_ptr<const Node> node = std::move(leaf);
+        for (unsigned above = 0; above < level; above += bits) {
+            auto branch = std::make_shared<Node>();
+            branch->children.push_back(std::move(node));
+            node = std::move(branch);
+        }
+        return node;
+    }
+};
+
+
+// Immutable JSON value whose strings and containers are reference counted and shared. Copying a handle
+// copies one pointer, and an update never changes a value: it returns a new root made of copies of the
+// containers on the path to the change, every other subtree being shared with the old root. Elements and
+// members are PersistentVectors, so copying a container with one child changed copies O(log32 width)
+// nodes of at most 32 handles, and an update costs O(depth) of such copies whatever the size of the
+// document. Every root stays valid and unchanged as long as a handle to it is kept.
+//
+// Handles can be read by any number of threads at once, but one handle object must not be assigned by a
+// thread while another one reads it: each thread keeps its own, see PersistentDocument.
+class PersistentValue {
+
+public:
+    using Member = std::pair<JsonKey, PersistentValue>;
+    using Elements = PersistentVector<PersistentValue>;
+    using Members = PersistentVector<Member>; // in insertion order
+
+    // Replacement of a value, given the current one
+    using Change = std::function<PersistentValue(const PersistentValue&)>;
+
+private:
+    struct Node;
+
+    // Strings and containers, shared. Null, booleans and numbers are kept in the handle itself.
+    std::shared_ptr<const Node> node;
+    JsonValue inlineValue;
+
+    explicit PersistentValue(std::shared_ptr<const Node> node) : node(std::move(node)) {}
+
+public:
+
+    PersistentValue() = default;
+
+    // Deep copy of a tree
+    explicit PersistentValue(const JsonValue& value);
+
+    // Containers made of existing handles, shared and not copied. A repeated key keeps its first
+    // position and its last value, as when parsing.
+    static PersistentValue array(std::vector<PersistentValue> elements);
+    static PersistentValue object(std::vector<Member> members);
+
+    // holding types
+    bool isBool() const;
+    bool isNumber() const;
+    bool isInteger() const;
+    bool isUnsigned() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+    bool isNull() const;
+
+    // Getter methods, same rules as the ones of JsonValue
+    const JsonValue::JsonString& getAsString() const;
+    std::string_view getAsStringView() const;
+    JsonValue::JsonNumber getAsNumber() const;
+    JsonValue::JsonInteger getAsInteger() const;
+    JsonValue::JsonUnsigned getAsUnsigned() const;
+    JsonValue::JsonBool getAsBool() const;
+    const Elements& getAsArray() const;
+    const Members& getAsObject() const;
+
+    // Access Object && Access Array. Objects past JsonObject::indexThreshold members are looked up in a
+    // hash table, itself a PersistentVector.
+    const PersistentValue& operator[](std::string_view str) const;
+    const PersistentValue& operator[](std::size_t idx) const;
+
+    // Walk a path of keys and indices
+    const PersistentValue& at(const JsonValue::pathInJson&) const;
+
+    // Number of members of an object or elements of an array
+    std::size_t size() const;
+
+    // Whether both handles share the same string or container, which is then equal without being compared
+    bool sameNode(const PersistentValue& other) const { return node && node == other.node; }
+
+    // Copy of the subtree as a mutable JsonValue
+    JsonValue materialize() const;
+
+    // New roots with one change, this one is left as it is. The path leads from this value to the one to
+    // change. update replaces it with change(current), a missing last key being added to its object with a
+    // null current value. set puts value there, erase removes it from its object or array, and append adds
+    // value at the end of the array at path. Only erase copies the whole container it removes from, the
+    // positions of the children after it changing.
+    PersistentValue update(const JsonValue::pathInJson& path, const Change& change) const;
+    PersistentValue set(const JsonValue::pathInJson& path, PersistentValue value) const;
+    PersistentValue erase(const JsonValue::pathInJson& path) const;
+    PersistentValue append(const JsonValue::pathInJson& path, PersistentValue value) const;
+
+private:
+
+    PersistentValue updateFrom(const JsonValue::pathInJson& path, std::size_t depth, const Change& change) const;
+
+    // Position of the member, SIZE_MAX if the key is missing
+    std::size_t findMember(std::string_view key) const;
+};
+
+
+// Document shared between reader threads and writers, as a series of immutable PersistentValue versions.
+// The current version is swapped atomically: a reader takes a snapshot, a consistent version that stays
+// valid and unchanged for as long as it keeps it, while writers publish new versions that share all the
+// subtrees they did not change with the previous one. Writers are serialized by a mutex, so an update is
+// never lost, and readers never take it.
+class PersistentDocument {
+
+private:
+    std::shared_ptr<const PersistentValue> root;
+    std::atomic<std::uint64_t> currentVersion{0};
+    std::mutex writer;
+
+public:
+
+    // Reader keeping a snapshot, which it only reloads when the document has changed since. Checking for a
+    // change is one atomic load, so a reader that calls get() for every request costs no more than a plain
+    // read while the document does not change. One Reader per thread.
+    class Reader {
+
+    private:
+        const PersistentDocument& document;
+        std::shared_ptr<const PersistentValue> current;
+        std::uint64_t seenVersion;
+
+    public:
+        explicit Reader(const PersistentDocument& document);
+
+        // The latest version
+        const PersistentValue& get();
+    };
+
+    explicit PersistentDocument(PersistentValue root = PersistentValue());
+    explicit PersistentDocument(const JsonValue& root);
+
+    PersistentDocument(const PersistentDocument&) = delete;
+    PersistentDocument& operator=(const PersistentDocument&) = delete;
+
+    // The current version
+    PersistentValue snapshot() const;
+
+    // Number of versions published since the construction
+    std::uint64_t version() const;
+
+    // Replace the whole document, e.g. after reloading it
+    void publish(PersistentValue newRoot);
+
+    // Publish change(current version), the writers being serialized. Returns the version published.
+    PersistentValue update(const PersistentValue::Change& change);
+
+    // Single updates, see PersistentValue
+    void modifyJson(const JsonValue::pathInJson& path, const JsonValue& value);
+    void addToObject(const JsonValue::pathInJson& path, std::string_view key, const JsonValue& value);
+    void addToArray(const JsonValue::pathInJson& path, const JsonValue& value);
+    void erase(const JsonValue::pathInJson& path);
+
+private:
+    std::shared_ptr<const PersistentValue> load() const;
+    void store(PersistentValue&& newRoot);
+};
+
+#endif
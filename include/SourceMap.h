@@ -0,0 +1,132 @@
+#ifndef SOURCEMAP_H
+#define SOURCEMAP_H
+
+#include "JsonValue.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// Where the arrays and objects of a file read by JsonParser::readWithSourceMap are in its text, with the
+// hash() each one had then. It lets a tree read this way be saved by rewriting only what changed: a
+// container whose cached hash is still the recorded one is equal to its text, which is kept as it is, so
+// only the containers on the paths that were modified (their hashes were cleared) are compared with their
+// text, member by member. The time to save depends on the edits, not on the size of the file, and the
+// formatting and key order of everything that did not change are kept. Values must be modified through
+// non-const access from the root (operator[], getAsObject, JsonPath::select, ...), see JsonValue::hash.
+class SourceMap {
+
+    friend class JsonParser;
+
+public:
+    // An array or object: its bytes [begin, end) and its hash when it was read
+    struct Span {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::uint64_t hash; // 0 once its bytes were overwritten
+    };
+
+    // Replace the bytes [begin, end) of the text with text
+    struct Splice {
+        std::uint64_t begin;
+        std::uint64_t end;
+        std::string text;
+    };
+
+private:
+    std::string filename;
+    MappedFile file;
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+
+    std::vector<Span> spans; // ordered by begin
+
+    // Containers compared with their text, by position, with their current hashes. The hashes are only
+    // recorded in the map: the caches of the values are cleared again, as references to their members may
+    // still be held and used to change them without clearing anything.
+    struct WalkedContainer {
+        std::uint64_t begin;
+        std::uint64_t hash;
+        const JsonValue* value;
+    };
+    using Walked = std::vector<WalkedContainer>;
+
+public:
+
+    SourceMap() = default;
+
+    // The text of the file, as read or as last written in place. Views of it are invalidated by write.
+    std::string_view text() const;
+
+    // Splices turning the text into the one of value, ordered and not overlapping. Changed values are
+    // written compact, added members and elements follow the separators of their container.
+    std::vector<Splice> diff(const JsonValue& value) const;
+
+    // Write the text of value to newFileName: the text of the source with the splices of diff.
+    // When newFileName is the source file and every splice fits in the bytes it replaces, only the splices
+    // are written, in place and padded with spaces, and the map follows the new text so the next saves are
+    // in place too. Otherwise the whole text is streamed to the file, through a temporary file renamed over
+    // the source when it is the target, and the map keeps describing the text it was read from.
+    void write(const std::string& newFileName, const JsonValue& value);
+
+private:
+
+    // Map the file, the spans are recorded by the parser
+    void open(const std::string& filename);
+
+    // Whether the file is the one mapped
+    bool isSource(const std::string& filename) const;
+
+    // Span starting at begin, null when there is none or its bytes were overwritten. It is searched from
+    // spans[from] onwards, where it is expected to be close.
+    const Span* findSpan(std::uint64_t begin, std::size_t from = 0) const;
+
+    std::uint64_t skipWhitespace(std::uint64_t pos) const;
+
+    // End of the container / string starting at begin, the container being scanned
+    std::uint64_t containerEnd(std::uint64_t begin) const;
+    std::uint64_t stringEnd(std::uint64_t begin) const;
+
+    // Decoded text of a string token
+    static std::string decode(std::string_view token);
+
+    // Whether the scalar token has the value of value
+    static bool sameScalar(const JsonValue& value, std::string_view token);
+
+    // Member / element of a container in the text, keyEnd is past the key of a member. span is the one of a
+    // container value, when it has one.
+    struct Item {
+        std::uint64_t start;
+        std::uint64_t keyEnd;
+        std::uint64_t valueBegin;
+        std::uint64_t valueEnd;
+        const Span* span;
+    };
+
+    // Whether the value of the item is unchanged, without walking it
+    bool unchanged(const JsonValue& value, const Item&) const;
+
+    // Append the splices turning the value of the item into value
+    void diffValue(const JsonValue& value, const Item&, std::vector<Splice>&, Walked*) const;
+    void diffObject(const JsonValue& value, const Item&, std::vector<Splice>&, Walked*) const;
+    void diffArray(const JsonValue& value, const Item&, std::vector<Splice>&, Walked*) const;
+
+    // Item of the value at begin, its span being searched from spans[cursor], which is then moved past it
+    Item itemAt(std::uint64_t start, std::uint64_t keyEnd, std::uint64_t begin, std::size_t& cursor) const;
+
+    // The members / elements of the container of the item, with the decoded keys of the members
+    std::vector<Item> itemsOf(const Item& container, std::vector<std::string>* keys) const;
+
+    // Separator to put between two members / elements of the container at begin: the one between its first
+    // two, a comma and the indentation of its only one, or a comma
+    std::string separator(std::uint64_t begin, const std::vector<Item>&) const;
+
+    // After the splices were written in place: map the new text, drop the spans overwritten and record
+    // the hashes of the containers that were walked
+    void followInPlace(const std::vector<Splice>&, const Walked&);
+};
+
+#endif
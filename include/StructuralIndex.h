@@ -0,0 +1,54 @@
+#ifndef STRUCTURALINDEX_H
+#define STRUCTURALINDEX_H
+
+#include <vector>
+#include <string_view>
+#include <stdexcept>
+#include <cstdint>
+
+
+// First stage of the parser: classifies the input 64 bytes per step and finds its structure.
+// The block classification is vectorized (AVX2 or SSE4.2 on x86-64) and picked at runtime,
+// with a scalar version for every other host.
+class StructuralIndex {
+
+public:
+
+    enum class Kernel {
+        Scalar,
+        SSE42,
+        AVX2
+    };
+
+    // Bit masks of one 64 byte block, bit i is the byte i of the block
+    struct BlockMasks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op; // { } [ ] : ,
+        uint64_t whitespace;
+    };
+
+    // Positions of the structural characters outside of strings, the opening quote of
+    // every string and the first byte of every number / true / false / null, in order.
+    // Positions are 32 bit, the input can be at most 4 GiB.
+    static std::vector<uint32_t> build(std::string_view);
+
+    // String state and nesting change over a part of a document, for both possible states at its start
+    // (index 0 when the part starts outside a string, 1 inside). The part must not start with an escaped byte.
+    struct Summary {
+        bool endsInString[2];
+        long depthChange[2];
+    };
+    static Summary summarize(std::string_view);
+
+    // Index of the first '"', '\\' or control character at or after from (input.size() if none)
+    static std::size_t findStringSpecial(std::string_view, std::size_t from);
+
+    // The kernel selected for this CPU
+    static Kernel activeKernel();
+
+    // Classify 64 bytes with the selected kernel
+    static void classify(const char* block, BlockMasks&);
+};
+
+#endif
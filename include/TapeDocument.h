@@ -0,0 +1,198 @@
+#ifndef TAPEDOCUMENT_H
+#define TAPEDOCUMENT_H
+
+#include "JsonValue.h"
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class TapeDocument;
+class TapeArray;
+class TapeObject;
+
+
+// Handle to a value of a TapeDocument. Reads never allocate, apart from getAsString and materialize.
+// A handle is only valid as long as its document is alive and not moved.
+class TapeValue {
+
+private:
+    const TapeDocument* document;
+    std::size_t entry; // Position of the value on the tape
+
+public:
+
+    TapeValue(const TapeDocument* document, std::size_t entry) : document(document), entry(entry) {}
+
+    // holding types
+    bool isBool() const;
+    bool isNumber() const;
+    bool isInteger() const;
+    bool isUnsigned() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+    bool isNull() const;
+
+    // Getter methods, same rules as the ones of JsonValue
+    std::string_view getAsStringView() const; // the characters in the string buffer, not copied
+    JsonValue::JsonString getAsString() const;
+    JsonValue::JsonNumber getAsNumber() const;
+    JsonValue::JsonInteger getAsInteger() const;
+    JsonValue::JsonUnsigned getAsUnsigned() const;
+    JsonValue::JsonBool getAsBool() const;
+
+    // Iteration over the elements / members, in document order
+    TapeArray getAsArray() const;
+    TapeObject getAsObject() const;
+
+    // Access Object && Access Array, every skipped subtree is one jump on the tape
+    TapeValue operator[](std::string_view str) const;
+    TapeValue operator[](std::size_t idx) const;
+
+    // Walk a path of keys and indices
+    TapeValue at(const JsonValue::pathInJson&) const;
+
+    // Number of members of an object or elements of an array
+    std::size_t size() const;
+
+    // Copy of the subtree as a mutable JsonValue, e.g. to modify it with modifyJson
+    JsonValue materialize() const;
+
+private:
+
+    friend class TapeArray;
+    friend class TapeObject;
+
+    char type() const;
+
+    // Tape position just past the value
+    std::size_t next() const;
+};
+
+
+// Elements of an array of a TapeDocument
+class TapeArray {
+
+private:
+    const TapeDocument* document;
+    std::size_t first; // Entry of the first element
+    std::size_t last;  // Entry of the closing bracket
+
+public:
+
+    class iterator {
+        const TapeDocument* document;
+        std::size_t entry;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TapeValue;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = TapeValue;
+
+        iterator(const TapeDocument* document, std::size_t entry) : document(document), entry(entry) {}
+
+        TapeValue operator*() const { return TapeValue(document, entry); }
+        iterator& operator++();
+        iterator operator++(int) { iterator previous = *this; ++*this; return previous; }
+        bool operator==(const iterator& other) const { return entry == other.entry; }
+        bool operator!=(const iterator& other) const { return entry != other.entry; }
+    };
+
+    TapeArray(const TapeDocument* document, std::size_t first, std::size_t last)
+        : document(document), first(first), last(last) {}
+
+    iterator begin() const { return iterator(document, first); }
+    iterator end() const { return iterator(document, last); }
+};
+
+
+// Members of an object of a TapeDocument, as (key, value) pairs like the ones of JsonObject
+class TapeObject {
+
+private:
+    const TapeDocument* document;
+    std::size_t first; // Entry of the key of the first member
+    std::size_t last;  // Entry of the closing brace
+
+public:
+
+    class iterator {
+        const TapeDocument* document;
+        std::size_t entry;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, TapeValue>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        iterator(const TapeDocument* document, std::size_t entry) : document(document), entry(entry) {}
+
+        value_type operator*() const;
+        iterator& operator++();
+        iterator operator++(int) { iterator previous = *this; ++*this; return previous; }
+        bool operator==(const iterator& other) const { return entry == other.entry; }
+        bool operator!=(const iterator& other) const { return entry != other.entry; }
+    };
+
+    TapeObject(const TapeDocument* document, std::size_t first, std::size_t last)
+        : document(document), first(first), last(last) {}
+
+    iterator begin() const { return iterator(document, first); }
+    iterator end() const { return iterator(document, last); }
+};
+
+
+// Immutable document laid out on a flat tape of 64-bit entries, in document order, plus one buffer
+// holding the characters of every string and key.
+//
+// An entry is a type character in its top byte and a 56 bit payload:
+//   n t f      null, true, false
+//   d l u      double, integer, unsigned; the 64 bits of the number are the next entry
+//   "          string or key, offset of its 4 byte length and characters in the string buffer
+//   [ {        opening of a container: the entry past its closing one (32 bits) and its count (24 bits,
+//              saturated), so a whole subtree is skipped with one jump
+//   ] }        closing of a container, the entry of its opening
+// A member of an object is its key entry followed by its value.
+class TapeDocument {
+
+    friend class TapeValue;
+    friend class TapeArray;
+    friend class TapeObject;
+
+private:
+    std::vector<std::uint64_t> tape;
+    std::string strings;
+
+    class Builder;
+
+public:
+
+    TapeDocument() = default;
+
+    // Parse JSON text onto a tape, same grammar as JsonStreamParser
+    static TapeDocument parse(std::string_view);
+
+    // Lay an existing value out on a tape
+    static TapeDocument fromValue(const JsonValue&);
+
+    TapeValue getRoot() const;
+
+    // Number of tape entries and bytes of the string buffer
+    std::size_t tapeSize() const { return tape.size(); }
+    std::size_t stringBufferSize() const { return strings.size(); }
+
+private:
+
+    char typeAt(std::size_t entry) const;
+    std::uint64_t payloadAt(std::size_t entry) const;
+    std::string_view stringAt(std::size_t entry) const;
+};
+
+#endif
@@ -0,0 +1,436 @@
+#include "../include/BinaryDocument.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+    constexpr std::string_view magic("JSNB\x01", 5);
+
+    enum Tag : unsigned char {
+        Null,
+        False,
+        True,
+        Double,
+        Integer,
+        Unsigned,
+        String,
+        Array,
+        Object
+    };
+
+    // Encoding
+
+    void putVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(char(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+
+    void putString(std::string& out, std::string_view str) {
+        putVarint(out, str.size());
+        out.append(str);
+    }
+
+    void putValue(std::string& out, const JsonValue& value) {
+        if (value.isObject()) {
+            const JsonValue::JsonObject& obj = value.getAsObject();
+            out.push_back(char(Tag::Object));
+            const std::size_t sizeAt = out.size();
+            out.append(4, '\0');
+            putVarint(out, obj.size());
+            for (const auto& member : obj) {
+                putString(out, member.first);
+                putValue(out, member.second);
+            }
+
+            // The size is known once the members are written
+            const std::size_t size = out.size() - sizeAt - 4;
+            if (size > UINT32_MAX) {
+                throw std::runtime_error("Value too large for the binary encoding");
+            }
+            for (int i = 0; i < 4; ++i) {
+                out[sizeAt + std::size_t(i)] = char(size >> (8 * i));
+            }
+
+        } else if (value.isArray()) {
+            const JsonValue::JsonArray& arr = value.getAsArray();
+            out.push_back(char(Tag::Array));
+            const std::size_t sizeAt = out.size();
+            out.append(4, '\0');
+            putVarint(out, arr.size());
+            for (const JsonValue& element : arr) {
+                putValue(out, element);
+            }
+
+            const std::size_t size = out.size() - sizeAt - 4;
+            if (size > UINT32_MAX) {
+                throw std::runtime_error("Value too large for the binary encoding");
+            }
+            for (int i = 0; i < 4; ++i) {
+                out[sizeAt + std::size_t(i)] = char(size >> (8 * i));
+            }
+
+        } else if (value.isString()) {
+            out.push_back(char(Tag::String));
+            putString(out, value.getAsStringView());
+
+        } else if (value.isInteger()) {
+            const std::uint64_t bits = std::uint64_t(value.getAsInteger());
+            out.push_back(char(Tag::Integer));
+            putVarint(out, (bits << 1) ^ (value.getAsInteger() < 0 ? ~std::uint64_t(0) : 0));
+
+        } else if (value.isUnsigned()) {
+            out.push_back(char(Tag::Unsigned));
+            putVarint(out, value.getAsUnsigned());
+
+        } else if (value.isNumber()) {
+            const double num = value.getAsNumber();
+            std::uint64_t bits;
+            std::memcpy(&bits, &num, sizeof(bits));
+            out.push_back(char(Tag::Double));
+            for (int i = 0; i < 8; ++i) {
+                out.push_back(char(bits >> (8 * i)));
+            }
+
+        } else if (value.isBool()) {
+            out.push_back(char(value.getAsBool() ? Tag::True : Tag::False));
+
+        } else {
+            out.push_back(char(Tag::Null));
+        }
+    }
+
+    // Decoding, every read is checked against the end of the input
+
+    struct Reader {
+        std::string_view data;
+        std::size_t pos;
+
+        // Where decoded values go: containers are allocated from resource, and when keys is set
+        // strings borrow their characters from data and keys are interned
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+        JsonKeyTable* keys = nullptr;
+
+        void need(std::size_t count) const {
+            if (count > data.size() - pos) {
+                throw std::runtime_error("Invalid binary JSON: unexpected end of input");
+            }
+        }
+
+        unsigned char byte() {
+            need(1);
+            return static_cast<unsigned char>(data[pos++]);
+        }
+
+        std::uint64_t fixed(int bytes) {
+            need(std::size_t(bytes));
+            std::uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value |= std::uint64_t(static_cast<unsigned char>(data[pos++])) << (8 * i);
+            }
+            return value;
+        }
+
+        std::uint64_t varint() {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const unsigned char b = byte();
+                value |= std::uint64_t(b & 0x7F) << shift;
+                if (b < 0x80) {
+                    return value;
+                }
+            }
+            throw std::runtime_error("Invalid binary JSON: varint too long");
+        }
+
+        std::string_view string() {
+            const std::uint64_t length = varint();
+            need(length);
+            const std::string_view str = data.substr(pos, length);
+            pos += length;
+            return str;
+        }
+
+        // Past the value starting at pos
+        void skip() {
+            switch (byte()) {
+                case Tag::Null:
+                case Tag::False:
+                case Tag::True: break;
+                case Tag::Double: need(8); pos += 8; break;
+                case Tag::Integer:
+                case Tag::Unsigned: varint(); break;
+                case Tag::String: string(); break;
+                case Tag::Array:
+                case Tag::Object: {
+                    const std::uint64_t size = fixed(4);
+                    need(size);
+                    pos += size;
+                    break;
+                }
+                default: throw std::runtime_error("Invalid binary JSON: unknown tag");
+            }
+        }
+
+        // Count of a container whose tag was read, the position is left on its first element / member
+        // and end is set past its last one
+        std::uint64_t openContainer(std::size_t& end) {
+            const std::uint64_t size = fixed(4);
+            need(size);
+            end = pos + size;
+            return varint();
+        }
+    };
+
+    JsonValue readValue(Reader& reader) {
+        switch (reader.byte()) {
+            case Tag::Null: return JsonValue();
+            case Tag::False: return JsonValue(JsonValue::JsonBool(false));
+            case Tag::True: return JsonValue(JsonValue::JsonBool(true));
+            case Tag::Double: {
+                const std::uint64_t bits = reader.fixed(8);
+                double num;
+                std::memcpy(&num, &bits, sizeof(num));
+                return JsonValue(num);
+            }
+            case Tag::Integer: {
+                const std::uint64_t zigzag = reader.varint();
+                return JsonValue(JsonValue::JsonInteger((zigzag >> 1) ^ (~(zigzag & 1) + 1)));
+            }
+            case Tag::Unsigned: return JsonValue(JsonValue::JsonUnsigned(reader.varint()));
+            case Tag::String:
+                if (reader.keys) {
+                    return JsonValue::borrowed(reader.string());
+                }
+                return JsonValue(JsonValue::JsonString(reader.string(), reader.resource));
+            case Tag::Array: {
+                std::size_t end;
+                const std::uint64_t count = reader.openContainer(end);
+                JsonValue::JsonArray arr(reader.resource);
+                arr.reserve(std::size_t(std::min<std::uint64_t>(count, reader.data.size() - reader.pos)));
+                for (std::uint64_t i = 0; i < count; ++i) {
+                    arr.push_back(readValue(reader));
+                }
+                if (reader.pos != end) {
+                    throw std::runtime_error("Invalid binary JSON: container size mismatch");
+                }
+                return JsonValue(std::move(arr));
+            }
+            case Tag::Object: {
+                std::size_t end;
+                const std::uint64_t count = reader.openContainer(end);
+                JsonValue::JsonObject obj{JsonValue::allocator_type(reader.resource)};
+                obj.reserve(std::size_t(std::min<std::uint64_t>(count, reader.data.size() - reader.pos)));
+                for (std::uint64_t i = 0; i < count; ++i) {
+                    const std::string_view key = reader.string();
+                    JsonKey member = reader.keys ? reader.keys->intern(key) : JsonKey(key, JsonValue::allocator_type(reader.resource));
+                    obj.insert_or_assign(std::move(member), readValue(reader));
+                }
+                if (reader.pos != end) {
+                    throw std::runtime_error("Invalid binary JSON: container size mismatch");
+                }
+                return JsonValue(std::move(obj));
+            }
+            default: throw std::runtime_error("Invalid binary JSON: unknown tag");
+        }
+    }
+}
+
+BinaryDocument::BinaryDocument(MappedFile &&mapped) : file(std::move(mapped)) {
+    if (file.view().substr(0, magic.size()) != magic) {
+        throw std::runtime_error("Invalid binary JSON: bad header");
+    }
+}
+
+BinaryValue BinaryDocument::getRoot() const {
+    return {this, 0};
+}
+
+void BinaryDocument::encode(const JsonValue &value, std::string &out) {
+    out.append(magic);
+    putValue(out, value);
+}
+
+JsonValue BinaryDocument::decode(std::string_view input) {
+    if (input.substr(0, magic.size()) != magic) {
+        throw std::runtime_error("Invalid binary JSON: bad header");
+    }
+
+    Reader reader{input.substr(magic.size()), 0};
+    JsonValue value = readValue(reader);
+    if (reader.pos != reader.data.size()) {
+        throw std::runtime_error("Invalid binary JSON: unexpected bytes after the value");
+    }
+    return value;
+}
+
+JsonDocument BinaryDocument::decodeDocument(std::string_view input) {
+    if (input.substr(0, magic.size()) != magic) {
+        throw std::runtime_error("Invalid binary JSON: bad header");
+    }
+
+    // Same as the text parser: the input is kept in the arena for the strings to borrow from
+    JsonDocument document(input.size() * 2);
+    const std::string_view body = input.substr(magic.size());
+    Reader reader{std::string_view(document.storeText(body), body.size()), 0};
+    reader.resource = document.getResource();
+    reader.keys = &document.getKeyTable();
+
+    document.setRoot(readValue(reader));
+    if (reader.pos != reader.data.size()) {
+        throw std::runtime_error("Invalid binary JSON: unexpected bytes after the value");
+    }
+    return document;
+}
+
+std::string_view BinaryDocument::body() const {
+    return file.view().substr(magic.size());
+}
+
+// -------------------------------------------------------
+
+unsigned char BinaryValue::tag() const {
+    Reader reader{document->body(), offset};
+    return reader.byte();
+}
+
+JsonValue BinaryValue::scalar() const {
+    Reader reader{document->body(), offset};
+    return readValue(reader);
+}
+
+bool BinaryValue::isBool() const {
+    return tag() == Tag::False || tag() == Tag::True;
+}
+
+bool BinaryValue::isNumber() const {
+    const unsigned char t = tag();
+    return t == Tag::Double || t == Tag::Integer || t == Tag::Unsigned;
+}
+
+bool BinaryValue::isInteger() const {
+    return tag() == Tag::Integer;
+}
+
+bool BinaryValue::isUnsigned() const {
+    return tag() == Tag::Unsigned;
+}
+
+bool BinaryValue::isString() const {
+    return tag() == Tag::String;
+}
+
+bool BinaryValue::isArray() const {
+    return tag() == Tag::Array;
+}
+
+bool BinaryValue::isObject() const {
+    return tag() == Tag::Object;
+}
+
+bool BinaryValue::isNull() const {
+    return tag() == Tag::Null;
+}
+
+std::string_view BinaryValue::getAsStringView() const {
+    Reader reader{document->body(), offset};
+    if (reader.byte() != Tag::String) {
+        throw std::runtime_error("Bad Access, not a string");
+    }
+    return reader.string();
+}
+
+JsonValue::JsonString BinaryValue::getAsString() const {
+    return JsonValue::JsonString(getAsStringView());
+}
+
+JsonValue::JsonNumber BinaryValue::getAsNumber() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return scalar().getAsNumber();
+}
+
+JsonValue::JsonInteger BinaryValue::getAsInteger() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return scalar().getAsInteger();
+}
+
+JsonValue::JsonUnsigned BinaryValue::getAsUnsigned() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return scalar().getAsUnsigned();
+}
+
+JsonValue::JsonBool BinaryValue::getAsBool() const {
+    if (!isBool()) {
+        throw std::runtime_error("Bad Access, not a boolean");
+    }
+    return tag() == Tag::True;
+}
+
+BinaryValue BinaryValue::operator[](std::string_view str) const {
+    Reader reader{document->body(), offset};
+    if (reader.byte() != Tag::Object) {
+        throw std::runtime_error("JsonValue is not an Object");
+    }
+
+    std::size_t end;
+    const std::uint64_t count = reader.openContainer(end);
+    for (std::uint64_t i = 0; i < count; ++i) {
+        if (reader.string() == str) {
+            return {document, reader.pos};
+        }
+        reader.skip();
+    }
+
+    throw std::runtime_error("Not able to find value to the given key");
+}
+
+BinaryValue BinaryValue::operator[](std::size_t idx) const {
+    Reader reader{document->body(), offset};
+    if (reader.byte() != Tag::Array) {
+        throw std::runtime_error("JsonValue is not an Array");
+    }
+
+    std::size_t end;
+    if (idx >= reader.openContainer(end)) {
+        throw std::runtime_error("Index out of range, unable to access array");
+    }
+    for (std::size_t i = 0; i < idx; ++i) {
+        reader.skip();
+    }
+    return {document, reader.pos};
+}
+
+BinaryValue BinaryValue::at(const JsonValue::pathInJson &path) const {
+    BinaryValue current = *this;
+
+    for (const auto &key : path) {
+        std::visit([&](auto&& arg) {
+            current = current[arg];
+        }, key);
+    }
+    return current;
+}
+
+std::size_t BinaryValue::size() const {
+    Reader reader{document->body(), offset};
+    const unsigned char t = reader.byte();
+    if (t != Tag::Object && t != Tag::Array) {
+        throw std::runtime_error("JsonValue is not an Object or an Array");
+    }
+    std::size_t end;
+    return std::size_t(reader.openContainer(end));
+}
+
+JsonValue BinaryValue::materialize() const {
+    Reader reader{document->body(), offset};
+    return readValue(reader);
+}
@@ -0,0 +1,160 @@
+#include "../include/JsonBuilder.h"
+#include <iterator>
+#include <tuple>
+
+JsonBuilder::JsonBuilder(std::pmr::memory_resource *resource) : resource(resource) {}
+
+JsonBuilder& JsonBuilder::beginObject() {
+    startContainer(true);
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::endObject() {
+    if (frames.empty() || !frames.back().isObject) {
+        throw std::runtime_error("endObject without an open object");
+    }
+    if (hasKey) {
+        throw std::runtime_error("Key without a value at the end of an object");
+    }
+
+    // Same as JsonParser::parseObject, a repeated key keeps its first position and its last value
+    Frame& frame = frames.back();
+    JsonValue::JsonObject obj{JsonValue::allocator_type(resource)};
+    obj.reserve(memberStack.size() - frame.base);
+    for (std::size_t i = frame.base; i < memberStack.size(); ++i) {
+        obj.insert_or_assign(std::move(memberStack[i].first), std::move(memberStack[i].second));
+    }
+    memberStack.resize(frame.base);
+
+    // Back to the key of the container when it is a member
+    frames.pop_back();
+    hasKey = !frames.empty() && frames.back().isObject;
+    add(JsonValue(std::move(obj)));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::beginArray() {
+    startContainer(false);
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::endArray() {
+    if (frames.empty() || frames.back().isObject) {
+        throw std::runtime_error("endArray without an open array");
+    }
+
+    Frame& frame = frames.back();
+    JsonValue::JsonArray arr{JsonValue::allocator_type(resource)};
+    arr.reserve(valueStack.size() - frame.base);
+    std::move(valueStack.begin() + std::ptrdiff_t(frame.base), valueStack.end(), std::back_inserter(arr));
+    valueStack.resize(frame.base);
+
+    // Back to the key of the container when it is a member
+    frames.pop_back();
+    hasKey = !frames.empty() && frames.back().isObject;
+    add(JsonValue(std::move(arr)));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::key(std::string_view str) {
+    if (frames.empty() || !frames.back().isObject) {
+        throw std::runtime_error("Key outside of an object: " + std::string(str));
+    }
+    if (hasKey) {
+        throw std::runtime_error("Key without a value before key: " + std::string(str));
+    }
+
+    memberStack.emplace_back(std::piecewise_construct, std::forward_as_tuple(str, JsonKey::allocator_type(resource)),
+                             std::forward_as_tuple());
+    hasKey = true;
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(JsonValue &&value) {
+    add(std::move(value));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(const JsonValue &value) {
+    add(JsonValue(value, JsonValue::allocator_type(resource)));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(std::string_view str) {
+    add(JsonValue(JsonValue::JsonString(str, JsonValue::JsonString::allocator_type(resource))));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(const char *str) {
+    return value(std::string_view(str));
+}
+
+JsonBuilder& JsonBuilder::value(JsonValue::JsonNumber num) {
+    add(JsonValue(num));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(JsonValue::JsonBool b) {
+    add(JsonValue(b));
+    return *this;
+}
+
+JsonBuilder& JsonBuilder::value(JsonValue::JsonNull) {
+    add(JsonValue());
+    return *this;
+}
+
+bool JsonBuilder::hasResult() const {
+    return complete;
+}
+
+JsonValue JsonBuilder::takeResult() {
+    if (!complete) {
+        throw std::runtime_error("No complete JSON value was built");
+    }
+
+    complete = false;
+    return std::move(result);
+}
+
+void JsonBuilder::reset() {
+    frames.clear();
+    memberStack.clear();
+    valueStack.clear();
+    hasKey = false;
+    result = JsonValue();
+    complete = false;
+}
+
+void JsonBuilder::add(JsonValue &&value) {
+    if (frames.empty()) {
+        if (complete) {
+            throw std::runtime_error("A complete JSON value was already built, call takeResult() first");
+        }
+        result = std::move(value);
+        complete = true;
+        return;
+    }
+
+    if (frames.back().isObject) {
+        if (!hasKey) {
+            throw std::runtime_error("Value inside an object without a key");
+        }
+        memberStack.back().second = std::move(value);
+        hasKey = false;
+    } else {
+        valueStack.push_back(std::move(value));
+    }
+}
+
+void JsonBuilder::startContainer(bool isObject) {
+    if (frames.empty() && complete) {
+        throw std::runtime_error("A complete JSON value was already built, call takeResult() first");
+    }
+    if (!frames.empty() && frames.back().isObject && !hasKey) {
+        throw std::runtime_error("Value inside an object without a key");
+    }
+
+    frames.push_back({isObject, isObject ? memberStack.size() : valueStack.size()});
+    hasKey = false;
+}
@@ -0,0 +1,92 @@
+#include "../include/JsonDocument.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace {
+
+    // Every live arena, for JsonArena::holding
+    std::mutex arenasMutex;
+    std::vector<JsonArena*> arenas;
+}
+
+JsonArena::JsonArena(std::size_t initialSize) : std::pmr::monotonic_buffer_resource(initialSize) {
+    const std::lock_guard<std::mutex> lock(arenasMutex);
+    arenas.push_back(this);
+}
+
+JsonArena::~JsonArena() {
+    const std::lock_guard<std::mutex> lock(arenasMutex);
+    arenas.erase(std::find(arenas.begin(), arenas.end(), this));
+}
+
+char* JsonArena::storeText(std::string_view text) {
+    char* copy = static_cast<char*>(allocate(std::max<std::size_t>(text.size(), 1), 1));
+    std::memcpy(copy, text.data(), text.size());
+    const std::lock_guard<std::mutex> lock(arenasMutex);
+    texts.emplace_back(copy, text.size());
+    return copy;
+}
+
+bool JsonArena::holds(const char* chars) const {
+    // Pointers into different blocks are only ordered by std::less
+    return std::any_of(texts.begin(), texts.end(), [chars](const std::pair<const char*, std::size_t>& text) {
+        return !std::less<const char*>()(chars, text.first) && !std::less<const char*>()(text.first + text.second, chars);
+    });
+}
+
+JsonArena* JsonArena::holding(const char* chars) {
+    const std::lock_guard<std::mutex> lock(arenasMutex);
+    const auto it = std::find_if(arenas.begin(), arenas.end(), [chars](const JsonArena* arena) {
+        return arena->holds(chars);
+    });
+    return it != arenas.end() ? *it : nullptr;
+}
+
+JsonDocument::JsonDocument(std::size_t sizeHint)
+    : arena(std::make_unique<JsonArena>(std::max<std::size_t>(sizeHint, 4096))),
+      keys(arena.get()) {}
+
+JsonDocument& JsonDocument::operator=(JsonDocument &&other) noexcept {
+    if (this != &other) {
+        // The old tree goes with the arena it lives in
+        root.abandon();
+        root = std::move(other.root);
+        keys = std::move(other.keys);
+        arena = std::move(other.arena);
+    }
+    return *this;
+}
+
+std::pmr::memory_resource* JsonDocument::getResource() const {
+    return arena.get();
+}
+
+JsonValue& JsonDocument::getRoot() {
+    return root;
+}
+
+const JsonValue& JsonDocument::getRoot() const {
+    return root;
+}
+
+JsonDocument::~JsonDocument() {
+    // The arena releases the whole tree at once, it is not walked
+    root.abandon();
+}
+
+void JsonDocument::setRoot(JsonValue &&value) {
+    // value may be inside the old root, it is taken first
+    JsonValue next(std::move(value), JsonValue::allocator_type(arena.get()));
+    root.abandon();
+    root = std::move(next);
+}
+
+JsonKeyTable& JsonDocument::getKeyTable() {
+    return keys;
+}
+
+char* JsonDocument::storeText(std::string_view text) {
+    return arena->storeText(text);
+}
\ No newline at end of file
@@ -0,0 +1,189 @@
+#include "../include/JsonKey.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(void*) != 8 || sizeof(JsonKey) == 32, "JsonKey is expected to be 32 bytes");
+
+JsonKey::JsonKey(const JsonKey &other, const allocator_type &alloc) : JsonKey() {
+    assign(other.view(), alloc.resource());
+}
+
+JsonKey::JsonKey(JsonKey &&other) noexcept : JsonKey() {
+    *this = std::move(other);
+}
+
+JsonKey::JsonKey(JsonKey &&other, const allocator_type &alloc) : JsonKey() {
+    // The characters go with the key only within their resource, e.g. not out of the arena of a document
+    const bool elsewhere = (other.storage == Storage::Allocated && *other.resource != *alloc.resource())
+        || (other.storage == Storage::Shared && *other.interned.owner != *alloc.resource());
+    if (elsewhere) {
+        assign(other.view(), alloc.resource());
+    } else {
+        *this = std::move(other);
+    }
+}
+
+JsonKey& JsonKey::operator=(const JsonKey &other) {
+    if (this != &other) {
+        // The characters go where this key allocated its own, if it has
+        *this = JsonKey(other, allocator_type(storage == Storage::Allocated ? resource : std::pmr::get_default_resource()));
+    }
+    return *this;
+}
+
+JsonKey& JsonKey::operator=(JsonKey &&other) noexcept {
+    if (this != &other) {
+        release();
+        length = other.length;
+        storage = other.storage;
+        switch (other.storage) {
+            case Storage::Inline:
+                std::memcpy(inlineChars, other.inlineChars, other.length);
+                chars = inlineChars;
+                break;
+            case Storage::Allocated:
+                chars = other.chars;
+                resource = other.resource;
+                other.storage = Storage::Inline;
+                other.chars = other.inlineChars;
+                other.length = 0;
+                break;
+            case Storage::Shared:
+                chars = other.chars;
+                interned = other.interned;
+                break;
+        }
+    }
+    return *this;
+}
+
+JsonKey::~JsonKey() {
+    release();
+}
+
+JsonKey JsonKey::shared(std::string_view chars, std::size_t hash, std::pmr::memory_resource* owner) {
+    JsonKey key;
+    key.chars = chars.data();
+    key.length = std::uint32_t(chars.size());
+    key.storage = Storage::Shared;
+    key.interned.hash = hash;
+    key.interned.owner = owner;
+    return key;
+}
+
+std::size_t JsonKey::hash() const {
+    return storage == Storage::Shared ? interned.hash : hashOf(view());
+}
+
+std::size_t JsonKey::hashOf(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+void JsonKey::assign(std::string_view key, std::pmr::memory_resource *target) {
+    if (key.size() > UINT32_MAX) {
+        throw std::runtime_error("Object key too long");
+    }
+
+    if (key.size() <= inlineCapacity) {
+        std::memcpy(inlineChars, key.data(), key.size());
+        chars = inlineChars;
+    } else {
+        char* copy = static_cast<char*>(target->allocate(key.size(), 1));
+        std::memcpy(copy, key.data(), key.size());
+        chars = copy;
+        resource = target;
+        storage = Storage::Allocated;
+    }
+    length = std::uint32_t(key.size());
+}
+
+void JsonKey::release() {
+    if (storage == Storage::Allocated) {
+        resource->deallocate(const_cast<char*>(chars), length, 1);
+    }
+    storage = Storage::Inline;
+    chars = inlineChars;
+    length = 0;
+}
+
+
+
+JsonKeyTable::JsonKeyTable(std::pmr::memory_resource *resource) : resource(resource) {}
+
+JsonKeyTable::JsonKeyTable(JsonKeyTable &&other) noexcept
+    : resource(other.resource), slots(std::move(other.slots)), count(other.count) {
+    other.slots.clear();
+    other.count = 0;
+}
+
+JsonKeyTable& JsonKeyTable::operator=(JsonKeyTable &&other) noexcept {
+    if (this != &other) {
+        release();
+        resource = other.resource;
+        slots = std::move(other.slots);
+        count = other.count;
+        other.slots.clear();
+        other.count = 0;
+    }
+    return *this;
+}
+
+JsonKeyTable::~JsonKeyTable() {
+    release();
+}
+
+JsonKey JsonKeyTable::intern(std::string_view key) {
+    if (key.size() > UINT32_MAX) {
+        throw std::runtime_error("Object key too long");
+    }
+
+    if ((count + 1) * 2 > slots.size()) {
+        grow();
+    }
+
+    const std::size_t hash = JsonKey::hashOf(key);
+    const std::size_t mask = slots.size() - 1;
+    std::size_t slot = hash & mask;
+    for (; slots[slot].chars != nullptr; slot = (slot + 1) & mask) {
+        const Slot& entry = slots[slot];
+        if (entry.hash == hash && std::string_view(entry.chars, entry.length) == key) {
+            return JsonKey::shared(std::string_view(entry.chars, entry.length), hash, resource);
+        }
+    }
+
+    // First occurrence, an empty key still needs a non null address
+    char* copy = static_cast<char*>(resource->allocate(key.empty() ? 1 : key.size(), 1));
+    std::memcpy(copy, key.data(), key.size());
+    slots[slot] = Slot{copy, std::uint32_t(key.size()), hash};
+    ++count;
+    return JsonKey::shared(std::string_view(copy, key.size()), hash, resource);
+}
+
+void JsonKeyTable::grow() {
+    std::vector<Slot> old(std::max<std::size_t>(slots.size() * 2, 64));
+    old.swap(slots);
+
+    const std::size_t mask = slots.size() - 1;
+    for (const Slot& entry : old) {
+        if (entry.chars != nullptr) {
+            std::size_t slot = entry.hash & mask;
+            while (slots[slot].chars != nullptr) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+    }
+}
+
+void JsonKeyTable::release() {
+    for (const Slot& entry : slots) {
+        if (entry.chars != nullptr) {
+            resource->deallocate(const_cast<char*>(entry.chars), entry.length == 0 ? 1 : entry.length, 1);
+        }
+    }
+    slots.clear();
+    count = 0;
+}
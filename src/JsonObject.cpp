@@ -0,0 +1,242 @@
+#include "../include/JsonObject.h"
+
+namespace {
+
+    bool sameKey(const JsonKey& stored, std::string_view key) {
+        return stored.size() == key.size() && stored.view() == key;
+    }
+}
+
+JsonObject::JsonObject(const JsonObject &other, const allocator_type &alloc)
+    : members(other.members, alloc), index(other.index, alloc) {}
+
+JsonObject::JsonObject(JsonObject &&other, const allocator_type &alloc)
+    : members(std::move(other.members), alloc), index(std::move(other.index), alloc) {}
+
+std::size_t JsonObject::hashKey(std::string_view key) {
+    return JsonKey::hashOf(key);
+}
+
+JsonObject::allocator_type JsonObject::get_allocator() const {
+    return members.get_allocator();
+}
+
+JsonObject::iterator JsonObject::find(std::string_view key) {
+    return members.begin() + std::ptrdiff_t(findPosition(key));
+}
+
+JsonObject::const_iterator JsonObject::find(std::string_view key) const {
+    return members.begin() + std::ptrdiff_t(findPosition(key));
+}
+
+JsonObject::iterator JsonObject::find(std::string_view key, std::size_t hash) {
+    return members.begin() + std::ptrdiff_t(findPosition(key, hash));
+}
+
+JsonObject::const_iterator JsonObject::find(std::string_view key, std::size_t hash) const {
+    return members.begin() + std::ptrdiff_t(findPosition(key, hash));
+}
+
+bool JsonObject::contains(std::string_view key) const {
+    return findPosition(key) != members.size();
+}
+
+JsonValue& JsonObject::operator[](std::string_view key) {
+    const std::size_t position = findPosition(key);
+    if (position != members.size()) {
+        return members[position].second;
+    }
+
+    members.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+    indexMember(members.size() - 1);
+    return members.back().second;
+}
+
+std::pair<JsonObject::iterator, bool> JsonObject::insert_or_assign(JsonKey &&key, JsonValue &&value) {
+    const std::size_t position = findPosition(key);
+    if (position != members.size()) {
+        members[position].second = JsonValue(std::move(value), get_allocator());
+        return {members.begin() + std::ptrdiff_t(position), false};
+    }
+
+    members.emplace_back(std::move(key), std::move(value));
+    indexMember(members.size() - 1);
+    return {members.end() - 1, true};
+}
+
+JsonObject::iterator JsonObject::insert(const_iterator position, JsonKey &&key, JsonValue &&value) {
+    const std::ptrdiff_t offset = position - members.cbegin();
+    members.emplace(position, std::move(key), std::move(value));
+
+    // The members after the new one moved, their positions in the index are stale
+    if (members.size() > indexThreshold) {
+        rebuildIndex();
+    }
+    return members.begin() + offset;
+}
+
+std::size_t JsonObject::erase(std::string_view key) {
+    const std::size_t position = findPosition(key);
+    if (position == members.size()) {
+        return 0;
+    }
+
+    if (!index.empty()) {
+        unindexMember(position);
+    }
+    members.erase(members.begin() + std::ptrdiff_t(position));
+
+    if (members.size() <= indexThreshold) {
+        index.clear();
+        index.shrink_to_fit();
+    } else if (position < members.size()) {
+        // The members after the removed one moved down by one
+        for (uint32_t& entry : index) {
+            if (entry > position + 1) {
+                entry--;
+            }
+        }
+    }
+    return 1;
+}
+
+std::size_t JsonObject::erase(const std::vector<std::string_view> &keys) {
+    std::vector<bool> removed(members.size());
+    std::size_t count = 0;
+    for (std::string_view key : keys) {
+        const std::size_t position = findPosition(key);
+        if (position != members.size() && !removed[position]) {
+            removed[position] = true;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Each member kept moves once, and the index is built once for all the removals
+    std::size_t kept = 0;
+    for (std::size_t position = 0; position < members.size(); ++position) {
+        if (!removed[position]) {
+            if (kept != position) {
+                members[kept] = std::move(members[position]);
+            }
+            kept++;
+        }
+    }
+    members.erase(members.begin() + std::ptrdiff_t(kept), members.end());
+    rebuildIndex();
+    return count;
+}
+
+void JsonObject::clear() {
+    members.clear();
+    index.clear();
+}
+
+std::size_t JsonObject::findPosition(std::string_view key) const {
+    return findPosition(key, index.empty() ? 0 : hashKey(key));
+}
+
+std::size_t JsonObject::findPosition(std::string_view key, std::size_t hash) const {
+    if (index.empty()) {
+        // Small object, a linear scan over the contiguous members beats hashing
+        for (std::size_t i = 0; i < members.size(); ++i) {
+            if (sameKey(members[i].first, key)) {
+                return i;
+            }
+        }
+        return members.size();
+    }
+
+    const std::size_t mask = index.size() - 1;
+    for (std::size_t slot = hash & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        const std::size_t position = index[slot] - 1;
+        if (sameKey(members[position].first, key)) {
+            return position;
+        }
+    }
+    return members.size();
+}
+
+std::size_t JsonObject::findPosition(const JsonKey &key) const {
+    if (index.empty()) {
+        for (std::size_t i = 0; i < members.size(); ++i) {
+            if (members[i].first == key) {
+                return i;
+            }
+        }
+        return members.size();
+    }
+
+    const std::size_t mask = index.size() - 1;
+    for (std::size_t slot = key.hash() & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        const std::size_t position = index[slot] - 1;
+        if (members[position].first == key) {
+            return position;
+        }
+    }
+    return members.size();
+}
+
+void JsonObject::indexMember(std::size_t position) {
+    if (members.size() <= indexThreshold) {
+        return;
+    }
+
+    // Keep the table at most half full
+    if (index.empty() || members.size() * 2 > index.size()) {
+        rebuildIndex();
+        return;
+    }
+
+    const std::size_t mask = index.size() - 1;
+    std::size_t slot = members[position].first.hash() & mask;
+    while (index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    index[slot] = uint32_t(position + 1);
+}
+
+void JsonObject::unindexMember(std::size_t position) {
+    const std::size_t mask = index.size() - 1;
+    std::size_t hole = members[position].first.hash() & mask;
+    while (index[hole] != position + 1) {
+        hole = (hole + 1) & mask;
+    }
+
+    // Backward shift: the entries of the probe run after the hole move into it unless that would put them
+    // before their home slot, so every lookup still finds its key without tombstones
+    index[hole] = 0;
+    for (std::size_t slot = (hole + 1) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+        const std::size_t home = members[index[slot] - 1].first.hash() & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            index[hole] = index[slot];
+            index[slot] = 0;
+            hole = slot;
+        }
+    }
+}
+
+void JsonObject::rebuildIndex() {
+    index.clear();
+    if (members.size() <= indexThreshold) {
+        index.shrink_to_fit();
+        return;
+    }
+
+    std::size_t capacity = 64;
+    while (capacity < members.size() * 4) {
+        capacity *= 2;
+    }
+    index.assign(capacity, 0);
+
+    const std::size_t mask = capacity - 1;
+    for (std::size_t position = 0; position < members.size(); ++position) {
+        std::size_t slot = members[position].first.hash() & mask;
+        while (index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = uint32_t(position + 1);
+    }
+}
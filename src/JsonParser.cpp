@@ -1,13 +1,219 @@
 #include "../include/JsonParser.h"
+#include "../include/MappedFile.h"
+#include "../include/StructuralIndex.h"
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+    bool isDelimiter(char c) {
+        return c == ',' || c == ':' || c == '{' || c == '}' || c == '[' || c == ']';
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    // An optional minus followed by digits only
+    bool isIntegerLiteral(std::string_view literal) {
+        size_t i = !literal.empty() && literal[0] == '-' ? 1 : 0;
+        if (i == literal.size()) {
+            return false;
+        }
+        for (; i < literal.size(); ++i) {
+            if (literal[i] < '0' || literal[i] > '9') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    unsigned parseHex4(std::string_view input, size_t index) {
+        if (index + 4 > input.size()) {
+            throw std::runtime_error("Invalid unicode escape in JSON string");
+        }
+
+        unsigned code = 0;
+        for (size_t i = index; i < index + 4; ++i) {
+            const char c = input[i];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= unsigned(c - '0');
+            else if (c >= 'a' && c <= 'f') code |= unsigned(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') code |= unsigned(c - 'A' + 10);
+            else throw std::runtime_error("Invalid unicode escape in JSON string");
+        }
+        return code;
+    }
+
+    template <typename Out>
+    void appendUtf8To(Out& out, unsigned code) {
+        if (code < 0x80) {
+            out.push_back(char(code));
+        } else if (code < 0x800) {
+            out.push_back(char(0xC0 | (code >> 6)));
+            out.push_back(char(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(char(0xE0 | (code >> 12)));
+            out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(char(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(char(0xF0 | (code >> 18)));
+            out.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+            out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(char(0x80 | (code & 0x3F)));
+        }
+    }
+
+    // Decode the escape sequence whose backslash is right before index
+    template <typename Out>
+    void decodeEscape(std::string_view input, size_t& index, Out& out) {
+        const char c = input[index++];
+        switch (c) {
+            case '\\': out.push_back('\\'); break;
+            case '"': out.push_back('"'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                unsigned code = parseHex4(input, index);
+                index += 4;
+
+                // Surrogate pair, the low half must follow as another \u escape
+                if (code >= 0xD800 && code <= 0xDBFF && index + 1 < input.size()
+                    && input[index] == '\\' && input[index + 1] == 'u') {
+                    unsigned low = parseHex4(input, index + 2);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        index += 6;
+                    }
+                }
+                appendUtf8To(out, code);
+                break;
+            }
+            default: out.push_back(c); break;
+        }
+    }
+
+    // Writes decoded characters over the input already read, never longer than their escape sequence
+    struct InSituOutput {
+        char* next;
+
+        void push_back(char c) {
+            *next++ = c;
+        }
+    };
+
+    // Segments of a parallel parse are at least this long
+    constexpr size_t minSegmentSize = size_t(1) << 20;
+
+    // String state and nesting depth at a point of the input
+    struct SegmentState {
+        bool inString;
+        long depth;
+    };
+
+    // First comma between two elements of the root container at or after begin, npos if there is none
+    size_t findRootComma(std::string_view input, size_t begin, SegmentState state) {
+        for (size_t i = begin; i < input.size(); ++i) {
+            if (state.inString) {
+                i = StructuralIndex::findStringSpecial(input, i);
+                if (i == input.size()) {
+                    break;
+                }
+                if (input[i] == '\\') {
+                    ++i;
+                } else if (input[i] == '"') {
+                    state.inString = false;
+                }
+                continue;
+            }
+
+            switch (input[i]) {
+                case '"': state.inString = true; break;
+                case '{':
+                case '[': ++state.depth; break;
+                case '}':
+                case ']':
+                    if (--state.depth == 0) {
+                        return input.npos;
+                    }
+                    break;
+                case ',':
+                    if (state.depth == 1) {
+                        return i;
+                    }
+                    break;
+                default: break;
+            }
+        }
+        return input.npos;
+    }
 
-JsonValue JsonParser::parse(const std::vector<Token> & tokens){
+    // Run work(0) ... work(count - 1) on their own threads
+    template <typename Work>
+    void runParallel(size_t count, Work work) {
+        std::vector<std::thread> workers;
+        workers.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            workers.emplace_back(work, i);
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Restores a setting of the parser, e.g. its memory resource, when a parse into a document ends
+    template <typename T>
+    struct ParserScope {
+        T& slot;
+        T saved;
+
+        ParserScope(T& current, T next)
+            : slot(current), saved(current) {
+            slot = next;
+        }
+        ~ParserScope() {
+            slot = saved;
+        }
+    };
+
+    // Truncates a scratch stack back to its size when a parse started, whether the parse returns or throws.
+    // After an error the stack still holds values from the memory resource of the parse, e.g. the arena of
+    // a document that is destroyed while the exception unwinds, so they must go first.
+    template <typename Stack>
+    struct StackScope {
+        Stack& stack;
+        std::size_t base;
+
+        explicit StackScope(Stack& stack)
+            : stack(stack), base(stack.size()) {}
+        ~StackScope() {
+            stack.erase(stack.begin() + std::ptrdiff_t(base), stack.end());
+        }
+    };
+}
+
+JsonValue JsonParser::parse(std::string_view input){
 
     size_t index = 0;
-    JsonValue result = parseValue(tokens, index);
+    const StackScope<std::vector<JsonValue>> valueScope(valueStack);
+    const StackScope<std::vector<std::pair<JsonKey, JsonValue>>> memberScope(memberStack);
+    JsonValue result = parseValue(input, index);
 
-    if (index != tokens.size()) {
+    skipWhitespace(input, index);
+    if (index != input.size()) {
         throw std::runtime_error("Unexpected tokens after the end of the JSON input");
     }
     return result;
@@ -16,198 +222,706 @@ JsonValue JsonParser::parse(const std::vector<Token> & tokens){
 
 
 JsonValue JsonParser::readFromFile(const std::string & filename) {
-    std::ifstream file(filename);
+    // The whole file is mapped (or bulk read) and parsed as one contiguous buffer
+    const MappedFile file(filename);
+    return parse(file.view());
+}
+
+
+
+JsonValue JsonParser::parseValidated(std::string_view input, const JsonSchema & schema) {
+    JsonValueBuilder builder;
+    JsonSchemaValidator validator(schema, &builder);
+    JsonStreamParser parser(validator);
+    parser.feed(input);
+    parser.finish();
+    return builder.takeResult();
+}
+
+JsonValue JsonParser::readValidated(const std::string & filename, const JsonSchema & schema) {
+    const MappedFile file(filename);
+    return parseValidated(file.view(), schema);
+}
+
+
+
+JsonValue JsonParser::parseParallel(std::string_view input, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    size_t rootIndex = 0;
+    skipWhitespace(input, rootIndex);
+    const size_t segmentCount = std::min<size_t>(threads, input.size() / minSegmentSize);
+    if (segmentCount <= 1 || rootIndex >= input.size() || (input[rootIndex] != '[' && input[rootIndex] != '{')) {
+        return parse(input);
+    }
+    const bool isArray = input[rootIndex] == '[';
+
+    // Cut the input in segments of the same size, a cut never follows a backslash so no escape spans two segments
+    std::vector<size_t> cuts{rootIndex + 1};
+    for (size_t i = 1; i < segmentCount; ++i) {
+        size_t cut = std::max(cuts.back(), input.size() / segmentCount * i);
+        while (cut < input.size() && input[cut - 1] == '\\') {
+            cut++;
+        }
+        cuts.push_back(cut);
+    }
+    cuts.push_back(input.size());
+
+    // Each segment is scanned for both possible states at its start, inside or outside a string,
+    // then the real state at every cut follows from the first one
+    std::vector<StructuralIndex::Summary> summaries(segmentCount);
+    runParallel(segmentCount, [&](size_t i) {
+        summaries[i] = StructuralIndex::summarize(input.substr(cuts[i], cuts[i + 1] - cuts[i]));
+    });
+
+    std::vector<SegmentState> states{{false, 1}};
+    for (size_t i = 0; i + 1 < segmentCount; ++i) {
+        const int start = states[i].inString ? 1 : 0;
+        states.push_back({summaries[i].endsInString[start], states[i].depth + summaries[i].depthChange[start]});
+    }
+
+    // Every segment after the first starts after the first comma between two root elements following its cut
+    std::vector<size_t> boundaries(segmentCount, input.npos);
+    runParallel(segmentCount - 1, [&](size_t i) {
+        boundaries[i + 1] = findRootComma(input, cuts[i + 1], states[i + 1]);
+    });
+    boundaries[0] = rootIndex;
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+    boundaries.erase(std::remove(boundaries.begin() + 1, boundaries.end(), input.npos), boundaries.end());
+
+    // Parse the elements between two boundaries, the last range ends with the root container
+    const size_t rangeCount = boundaries.size();
+    std::vector<JsonParser> parsers(rangeCount);
+    std::vector<std::exception_ptr> errors(rangeCount);
+    runParallel(rangeCount, [&](size_t i) {
+        try {
+            size_t index = boundaries[i] + 1;
+            const size_t boundary = i + 1 < rangeCount ? boundaries[i + 1] : input.npos;
+            if (isArray) {
+                parsers[i].parseArrayRange(input, index, boundary);
+            } else {
+                parsers[i].parseObjectRange(input, index, boundary);
+            }
+
+            if (boundary == input.npos) {
+                skipWhitespace(input, index);
+                if (index != input.size()) {
+                    throw std::runtime_error("Unexpected tokens after the end of the JSON input");
+                }
+            }
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+
+    // Invalid input is parsed again serially so the error is the same as with parse
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            return parse(input);
+        }
+    }
+
+    // Stitch the ranges in order
+    size_t total = 0;
+    for (const JsonParser& parser : parsers) {
+        total += isArray ? parser.valueStack.size() : parser.memberStack.size();
+    }
+
+    if (isArray) {
+        JsonValue::JsonArray arr(resource);
+        arr.reserve(total);
+        for (JsonParser& parser : parsers) {
+            std::move(parser.valueStack.begin(), parser.valueStack.end(), std::back_inserter(arr));
+        }
+        return JsonValue(std::move(arr));
+    }
+
+    JsonValue::JsonObject obj(resource);
+    obj.reserve(total);
+    for (JsonParser& parser : parsers) {
+        for (auto& member : parser.memberStack) {
+            obj.insert_or_assign(std::move(member.first), std::move(member.second));
+        }
+    }
+    return JsonValue(std::move(obj));
+}
+
+
+
+JsonValue JsonParser::readFromFileParallel(const std::string & filename, unsigned threads) {
+    const MappedFile file(filename);
+    return parseParallel(file.view(), threads);
+}
+
+
+
+JsonDocument JsonParser::parseDocument(std::string_view input) {
+    JsonDocument document(input.size() * 2);
+    char* text = document.storeText(input);
+
+    const ParserScope<std::pmr::memory_resource*> resourceScope(resource, document.getResource());
+    const ParserScope<char*> textScope(inSitu, text);
+    const ParserScope<JsonKeyTable*> keyScope(keyTable, &document.getKeyTable());
+    document.setRoot(parse(std::string_view(text, input.size())));
+    return document;
+}
+
+
+
+JsonDocument JsonParser::readDocument(const std::string & filename) {
+    const MappedFile file(filename);
+    return parseDocument(file.view());
+}
+
+
+
+// Part of an NDJSON file, from one line start up to another
+struct JsonParser::LineChunk {
+    size_t begin;
+    size_t end;
+    std::vector<JsonValue> records;
+    std::exception_ptr error;
+    size_t errorOffset = 0; // start of the line that failed
+    bool done = false;
+};
+
+std::vector<JsonValue> JsonParser::readLinesFromFile(const std::string & filename, unsigned threads) {
+    std::vector<JsonValue> records;
+    readLinesFromFile(filename, [&records](JsonValue&& record) { records.push_back(std::move(record)); }, threads);
+    return records;
+}
+
+
+
+void JsonParser::readLinesFromFile(const std::string & filename, const std::function<void(JsonValue&&)> & receive,
+                                   unsigned threads) {
+    const MappedFile file(filename);
+    const std::string_view input = file.view();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Enough chunks per thread to balance uneven lines, each ending after a line break
+    const size_t chunkSize = std::max<size_t>(size_t(1) << 20, input.size() / (size_t(threads) * 16));
+    std::vector<LineChunk> chunks;
+    for (size_t begin = 0; begin < input.size();) {
+        size_t end = begin + chunkSize < input.size() ? input.find('\n', begin + chunkSize) : input.npos;
+        end = end == input.npos ? input.size() : end + 1;
+        chunks.push_back({begin, end, {}, nullptr});
+        begin = end;
+    }
+
+    // Nothing to share, the chunks are parsed by the calling thread
+    if (threads == 1 || chunks.size() <= 1) {
+        for (LineChunk& chunk : chunks) {
+            parseLines(input, chunk);
+            deliverLines(input, chunk, receive);
+        }
+        return;
+    }
+
+    // Workers take the next chunk as soon as they are free, but never run more than window chunks
+    // ahead of the records handed to the callback
+    const size_t window = size_t(threads) * 4;
+    std::mutex mutex;
+    std::condition_variable chunkDone;
+    std::condition_variable chunkTaken;
+    size_t nextChunk = 0;
+    size_t delivered = 0;
+    bool stop = false;
+
+    auto work = [&]() {
+        JsonParser parser;
+        for (;;) {
+            size_t current;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkTaken.wait(lock, [&] {
+                    return stop || nextChunk >= chunks.size() || nextChunk < delivered + window;
+                });
+                if (stop || nextChunk >= chunks.size()) {
+                    return;
+                }
+                current = nextChunk++;
+            }
+
+            parser.parseLines(input, chunks[current]);
+
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                chunks[current].done = true;
+            }
+            chunkDone.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto stopWorkers = [&]() {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        chunkTaken.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    };
+
+    try {
+        for (unsigned i = 0; i < std::min<size_t>(threads, chunks.size()); ++i) {
+            workers.emplace_back(work);
+        }
+
+        for (size_t current = 0; current < chunks.size(); ++current) {
+            LineChunk& chunk = chunks[current];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkDone.wait(lock, [&] { return chunk.done; });
+            }
+
+            deliverLines(input, chunk, receive);
+
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                delivered = current + 1;
+            }
+            chunkTaken.notify_all();
+        }
+    } catch (...) {
+        stopWorkers();
+        throw;
+    }
+
+    stopWorkers();
+}
+
+
+
+LazyDocument JsonParser::readLazy(const std::string & filename) {
+    return LazyDocument(MappedFile(filename));
+}
+
+TapeDocument JsonParser::readTape(const std::string & filename) {
+    const MappedFile file(filename);
+    return TapeDocument::parse(file.view());
+}
+
+
+
+void JsonParser::printToFile(const std::string & newFileName, const JsonValue & result, JsonWriter::Style style) {
+    std::ofstream file(newFileName, std::ios::binary);
+
     if (!file.is_open()){
         throw std::runtime_error("Unable to open file");
     }
 
-    std::vector<Token> tokens = tokenizeJSONfile(file);
+    JsonWriter writer(style);
+    writer.write(result);
+    writer.flush(file);
     file.close();
-    return parse(tokens);
 }
 
+JsonValue JsonParser::readWithSourceMap(const std::string & filename, SourceMap & map) {
+    map.open(filename);
+    const ParserScope<std::vector<SourceMap::Span>*> spanScope(spans, &map.spans);
+    return parse(map.text());
+}
 
+void JsonParser::printPatchedToFile(const std::string & newFileName, const JsonValue & result, SourceMap & map) {
+    map.write(newFileName, result);
+}
 
-void JsonParser::printToFile(const std::string & newFileName, const JsonValue & result) {
-    std::ofstream file(newFileName);
+void JsonParser::printBinaryToFile(const std::string & newFileName, const JsonValue & result) {
+    std::ofstream file(newFileName, std::ios::binary);
 
     if (!file.is_open()){
         throw std::runtime_error("Unable to open file");
     }
 
-    result.readablePrint(file);
+    std::string encoded;
+    BinaryDocument::encode(result, encoded);
+    file.write(encoded.data(), std::streamsize(encoded.size()));
     file.close();
 }
 
-JsonValue JsonParser::parseValue(const std::vector<Token> &tokens, size_t &index){
-    {
+JsonValue JsonParser::readBinaryFromFile(const std::string & filename) {
+    const MappedFile file(filename);
+    return BinaryDocument::decode(file.view());
+}
 
-        if (index >= tokens.size()) {
-            throw std::runtime_error("Unexpected end of input");
+JsonDocument JsonParser::readBinaryDocument(const std::string & filename) {
+    const MappedFile file(filename);
+    return BinaryDocument::decodeDocument(file.view());
+}
+
+BinaryDocument JsonParser::readBinary(const std::string & filename) {
+    return BinaryDocument(MappedFile(filename));
+}
+
+void JsonParser::parseLines(std::string_view input, LineChunk &chunk) {
+    size_t lineStart = chunk.begin;
+    while (lineStart < chunk.end) {
+        size_t lineEnd = input.find('\n', lineStart);
+        lineEnd = std::min(lineEnd, chunk.end);
+
+        size_t index = lineStart;
+        skipWhitespace(input, index);
+        if (index < lineEnd) {
+            try {
+                chunk.records.push_back(parse(input.substr(lineStart, lineEnd - lineStart)));
+            } catch (...) {
+                chunk.error = std::current_exception();
+                chunk.errorOffset = lineStart;
+                return;
+            }
         }
 
-        // First index is the beginning of the jsonFile
-        const Token& token = tokens[index++];
+        lineStart = lineEnd + 1;
+    }
+}
+
+void JsonParser::deliverLines(std::string_view input, LineChunk &chunk,
+                              const std::function<void(JsonValue&&)> & receive) {
+    for (JsonValue& record : chunk.records) {
+        receive(std::move(record));
+    }
+    chunk.records = std::vector<JsonValue>();
+
+    if (chunk.error) {
+        const size_t line = size_t(std::count(input.begin(), input.begin() + std::ptrdiff_t(chunk.errorOffset), '\n')) + 1;
+        try {
+            std::rethrow_exception(chunk.error);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Line " + std::to_string(line) + ": " + e.what());
+        }
+    }
+}
 
-        // Based on the type, the automaton reads the beginning of the json file, we go to the next state accordingly.
-        switch (token.type) {
-            case TokenType::ObjectOpen:
-                return JsonValue(parseObject(tokens, index));
+void JsonParser::skipWhitespace(std::string_view input, size_t &index) {
+    while (index < input.size() && isSpace(input[index])) {
+        index++;
+    }
+}
 
-            case TokenType::ArrayOpen:
-                return JsonValue(parseArray(tokens, index));
+JsonValue JsonParser::parseValue(std::string_view input, size_t &index){
+    {
+        skipWhitespace(input, index);
 
-            case TokenType::String:
-                return JsonValue(JsonValue::JsonString(token.value));
+        if (index >= input.size()) {
+            throw std::runtime_error("Unexpected end of input");
+        }
 
-            case TokenType::Number: {
-                try {
-                    double num = std::stod(token.value);
-                    return JsonValue(JsonValue::JsonNumber(num));
-                } catch (const std::exception& e) {
-                    throw std::runtime_error("Invalid number format: " + token.value);
+        // Based on the first character, the automaton reads the beginning of the value, we go to the next state accordingly.
+        switch (input[index]) {
+            case '{':
+            case '[': {
+                const bool isObject = input[index] == '{';
+                const size_t begin = index++;
+                if (!spans) {
+                    return isObject ? JsonValue(parseObject(input, index)) : JsonValue(parseArray(input, index));
                 }
+
+                // The span of a container comes before the ones of its children, so they stay ordered by position.
+                // Its hash only combines the ones of its children, already cached.
+                const size_t slot = spans->size();
+                spans->push_back({begin, 0, 0});
+                JsonValue value = isObject ? JsonValue(parseObject(input, index)) : JsonValue(parseArray(input, index));
+                (*spans)[slot].end = index;
+                (*spans)[slot].hash = value.hash();
+                return value;
             }
 
-            case TokenType::True:
-                return JsonValue(JsonValue::JsonBool(true));
+            case '"': {
+                index++;
+                if (inSitu) {
+                    return JsonValue::borrowed(parseStringInSitu(input, index));
+                }
+                JsonValue::JsonString str(resource);
+                parseString(input, index, str);
+                return JsonValue(std::move(str));
+            }
 
-            case TokenType::False:
-                return JsonValue(JsonValue::JsonBool(false));
+            case '}':
+            case ']':
+            case ',':
+            case ':':
+                throw std::runtime_error("Unexpected token type");
 
-            case TokenType::Null:
-                return JsonValue(JsonValue::JsonNull{});
             default:
-                throw std::runtime_error("Unexpected token type");
+                return parseLiteral(input, index);
         }
     }
 }
 
-JsonValue::JsonArray JsonParser::parseArray(const std::vector<Token> &tokens, size_t &index) {
-    JsonValue::JsonArray arr;
+JsonValue::JsonArray JsonParser::parseArray(std::string_view input, size_t &index) {
+    const size_t base = valueStack.size();
 
-    while (index < tokens.size() && tokens[index].type != TokenType::ArrayClose) {
-        arr.push_back(parseValue(tokens, index));
+    skipWhitespace(input, index);
+    while (index < input.size() && input[index] != ']') {
+        valueStack.push_back(parseValue(input, index));
 
-        if (index < tokens.size() && tokens[index].type == TokenType::Comma) {
+        skipWhitespace(input, index);
+        if (index < input.size() && input[index] == ',') {
             index++;
+            skipWhitespace(input, index);
         }
     }
 
-    if (index >= tokens.size() || tokens[index].type != TokenType::ArrayClose) {
+    if (index >= input.size() || input[index] != ']') {
         throw std::runtime_error("Expected a closing bracket for the JSON array");
     }
 
     index++; // Skip the closing bracket
+
+    // The elements were collected on the stack, the array is allocated once with the exact size
+    JsonValue::JsonArray arr(resource);
+    arr.reserve(valueStack.size() - base);
+    std::move(valueStack.begin() + std::ptrdiff_t(base), valueStack.end(), std::back_inserter(arr));
+    valueStack.resize(base);
     return arr;
 }
 
-JsonValue::JsonObject JsonParser::parseObject(const std::vector<Token> &tokens, size_t &index) {
-    JsonValue::JsonObject obj;
+JsonValue::JsonObject JsonParser::parseObject(std::string_view input, size_t &index) {
+    const size_t base = memberStack.size();
 
-    while (index < tokens.size() && tokens[index].type != TokenType::ObjectClose) {
-        if (tokens[index].type != TokenType::String) {
+    skipWhitespace(input, index);
+    while (index < input.size() && input[index] != '}') {
+        if (input[index] != '"') {
             throw std::runtime_error("Expected a string key in the JSON object");
         }
 
-        std::string key = tokens[index++].value;
+        index++; // Skip the opening quote
+        JsonKey key = parseKey(input, index);
 
-        if (index >= tokens.size() || tokens[index].type != TokenType::Colon) {
+        skipWhitespace(input, index);
+        if (index >= input.size() || input[index] != ':') {
             throw std::runtime_error("Expected a colon after the JSON object key");
         }
 
         index++; // Skip the colon
-        JsonValue value = parseValue(tokens, index);
+        JsonValue value = parseValue(input, index);
 
-        if (index < tokens.size() && tokens[index].type == TokenType::Comma) {
+        skipWhitespace(input, index);
+        if (index < input.size() && input[index] == ',') {
             index++; // Skip the comma
+            skipWhitespace(input, index);
         }
 
-        obj[std::move(key)] = std::move(value);
+        memberStack.emplace_back(std::move(key), std::move(value));
     }
 
-    if (index >= tokens.size() || tokens[index].type != TokenType::ObjectClose) {
+    if (index >= input.size() || input[index] != '}') {
         throw std::runtime_error("Expected a closing brace for the JSON object");
     }
 
     index++; // Skip the closing brace
+
+    // Same as for arrays, a repeated key keeps its first position and its last value
+    JsonValue::JsonObject obj(resource);
+    obj.reserve(memberStack.size() - base);
+    for (size_t i = base; i < memberStack.size(); ++i) {
+        obj.insert_or_assign(std::move(memberStack[i].first), std::move(memberStack[i].second));
+    }
+    memberStack.resize(base);
     return obj;
 }
 
-std::vector<JsonParser::Token> JsonParser::tokenizeJSONfile(std::ifstream & stream) {
-    std::vector<Token> tokens;
-    std::string buffer;
+void JsonParser::parseArrayRange(std::string_view input, size_t &index, size_t boundary) {
+    // Same grammar as parseArray, stops once the comma at boundary is consumed
+    skipWhitespace(input, index);
+    while (index < input.size() && input[index] != ']') {
+        if (index > boundary) {
+            throw std::runtime_error("Element across a segment boundary");
+        }
+        valueStack.push_back(parseValue(input, index));
 
-    // Read file character by character
-    char c;
-    while (stream.get(c)) {
-        // get rid of white spaces
-        if (isspace(c)){
-            continue;
+        skipWhitespace(input, index);
+        if (index < input.size() && input[index] == ',') {
+            if (index++ == boundary) {
+                return;
+            }
+            skipWhitespace(input, index);
         }
+    }
 
-        // Switch for types of tokens
-        switch (c) {
-            case '{':
-                tokens.push_back({TokenType::ObjectOpen, "{"});
-                break;
-            case '}':
-                tokens.push_back({TokenType::ObjectClose, "}"});
-                break;
-            case '[':
-                tokens.push_back({TokenType::ArrayOpen, "["});
-                break;
-            case ']':
-                tokens.push_back({TokenType::ArrayClose, "]"});
-                break;
-            case ',':
-                tokens.push_back({TokenType::Comma, ","});
-                break;
-            case ':':
-                tokens.push_back({TokenType::Colon, ":"});
-                break;
-            case '"':
-                buffer.clear();
-                while (stream.get(c) && c != '"'){
-                    if (c == '\\' && stream.peek() != EOF) {
-                        stream.get(c); // Get next character
-                        switch (c) {
-                            case '\\': buffer.push_back('\\'); break;
-                            case '"': buffer.push_back('"'); break;
-                            case 'n': buffer.push_back('\n'); break;
-                            case 't': buffer.push_back('\t'); break;
-                            default: buffer.push_back(c); break;
-                        }
-                    } else {
-                        buffer.push_back(c);
-                    }
-                }
-                tokens.push_back({TokenType::String, buffer});
-                break;
+    if (index >= input.size() || boundary != input.npos) {
+        throw std::runtime_error("Expected a closing bracket for the JSON array");
+    }
+    index++; // Skip the closing bracket
+}
 
-            default:
-                buffer.clear();
-                while (!isspace(c) && c != ',' && c != ':' && c != '{' && c != '}'
-                       && c != '[' && c != ']' && stream.peek() != EOF) {
+void JsonParser::parseObjectRange(std::string_view input, size_t &index, size_t boundary) {
+    // Same grammar as parseObject, stops once the comma at boundary is consumed
+    skipWhitespace(input, index);
+    while (index < input.size() && input[index] != '}') {
+        if (index > boundary) {
+            throw std::runtime_error("Member across a segment boundary");
+        }
+        if (input[index] != '"') {
+            throw std::runtime_error("Expected a string key in the JSON object");
+        }
 
-                    buffer.push_back(c);
-                    stream.get(c);
-                }
-                // Step back to process the delimiter in the next iteration
-                stream.unget();
-
-                if (buffer == "true") {
-                    tokens.push_back({TokenType::True, buffer});
-                } else if (buffer == "false") {
-                    tokens.push_back({TokenType::False, buffer});
-                } else if (buffer == "null") {
-                    tokens.push_back({TokenType::Null, buffer});
-                } else {
-                    tokens.push_back({TokenType::Number, buffer});
-                }
-                break;
+        index++; // Skip the opening quote
+        JsonKey key = parseKey(input, index);
+
+        skipWhitespace(input, index);
+        if (index >= input.size() || input[index] != ':') {
+            throw std::runtime_error("Expected a colon after the JSON object key");
+        }
+
+        index++; // Skip the colon
+        memberStack.emplace_back(std::move(key), parseValue(input, index));
+
+        skipWhitespace(input, index);
+        if (index < input.size() && input[index] == ',') {
+            if (index++ == boundary) {
+                return;
+            }
+            skipWhitespace(input, index);
         }
     }
 
-    return tokens;
-}
\ No newline at end of file
+    if (index >= input.size() || boundary != input.npos) {
+        throw std::runtime_error("Expected a closing brace for the JSON object");
+    }
+    index++; // Skip the closing brace
+}
+
+void JsonParser::parseString(std::string_view input, size_t &index, JsonValue::JsonString &buffer) {
+    while (index < input.size()) {
+        // Copy the run of plain characters in one go, control characters are kept as they are
+        size_t start = index;
+        index = StructuralIndex::findStringSpecial(input, index);
+        while (index < input.size() && input[index] != '"' && input[index] != '\\') {
+            index = StructuralIndex::findStringSpecial(input, index + 1);
+        }
+        buffer.append(input.data() + start, index - start);
+
+        if (index >= input.size()) {
+            break;
+        }
+
+        if (input[index] == '"') {
+            index++; // Skip the closing quote
+            return;
+        }
+
+        // Escape sequence
+        index++;
+        if (index >= input.size()) {
+            break;
+        }
+        decodeEscape(input, index, buffer);
+    }
+
+    throw std::runtime_error("Unterminated string in the JSON input");
+}
+
+std::string_view JsonParser::parseStringInSitu(std::string_view input, size_t &index) {
+    // inSitu holds the same characters as input, decoded characters are written behind the read position
+    char* const begin = inSitu + index;
+    InSituOutput output{begin};
+
+    while (index < input.size()) {
+        size_t start = index;
+        index = StructuralIndex::findStringSpecial(input, index);
+        while (index < input.size() && input[index] != '"' && input[index] != '\\') {
+            index = StructuralIndex::findStringSpecial(input, index + 1);
+        }
+
+        // Until the first escape sequence the characters are already in place
+        if (output.next != inSitu + start) {
+            std::memmove(output.next, inSitu + start, index - start);
+        }
+        output.next += index - start;
+
+        if (index >= input.size()) {
+            break;
+        }
+
+        if (input[index] == '"') {
+            index++; // Skip the closing quote
+            return std::string_view(begin, size_t(output.next - begin));
+        }
+
+        // Escape sequence
+        index++;
+        if (index >= input.size()) {
+            break;
+        }
+        decodeEscape(input, index, output);
+    }
+
+    throw std::runtime_error("Unterminated string in the JSON input");
+}
+
+JsonKey JsonParser::parseKey(std::string_view input, size_t &index) {
+    std::string_view key;
+    if (inSitu) {
+        key = parseStringInSitu(input, index);
+    } else {
+        keyBuffer.clear();
+        parseString(input, index, keyBuffer);
+        key = keyBuffer;
+    }
+
+    return keyTable ? keyTable->intern(key) : JsonKey(key, JsonValue::allocator_type(resource));
+}
+
+JsonValue JsonParser::parseLiteral(std::string_view input, size_t &index) {
+    size_t start = index;
+    while (index < input.size() && !isSpace(input[index]) && !isDelimiter(input[index])) {
+        index++;
+    }
+
+    return parseLiteral(input.substr(start, index - start));
+}
+
+JsonValue JsonParser::parseLiteral(std::string_view literal) {
+    if (literal == "true") {
+        return JsonValue(JsonValue::JsonBool(true));
+    } else if (literal == "false") {
+        return JsonValue(JsonValue::JsonBool(false));
+    } else if (literal == "null") {
+        return JsonValue(JsonValue::JsonNull{});
+    }
+
+    // std::from_chars does not depend on the locale nor allocate, and the whole literal must be a number
+    const char* first = literal.data();
+    const char* last = first + literal.size();
+
+    // Integers are kept exact as long as they fit in 64 bits, -0 stays a double to keep its sign
+    if (isIntegerLiteral(literal)) {
+        JsonValue::JsonInteger integer = 0;
+        if (std::from_chars(first, last, integer).ec == std::errc()) {
+            if (integer != 0 || literal[0] != '-') {
+                return JsonValue(integer);
+            }
+        } else if (literal[0] != '-') {
+            JsonValue::JsonUnsigned unsignedInteger = 0;
+            if (std::from_chars(first, last, unsignedInteger).ec == std::errc()) {
+                return JsonValue(unsignedInteger);
+            }
+        }
+    }
+
+    // from_chars also reads nan, inf and infinity, which are not JSON and could not be written back
+    const std::size_t digit = !literal.empty() && literal[0] == '-' ? 1 : 0;
+    if (digit >= literal.size() || literal[digit] < '0' || literal[digit] > '9') {
+        throw std::runtime_error("Invalid number format: " + std::string(literal));
+    }
+
+    JsonValue::JsonNumber num = 0;
+    const auto [end, error] = std::from_chars(first, last, num);
+    if (error != std::errc() || end != last || !std::isfinite(num)) {
+        throw std::runtime_error("Invalid number format: " + std::string(literal));
+    }
+    return JsonValue(num);
+}
+
+void JsonParser::appendUtf8(JsonValue::JsonString & out, unsigned code) {
+    appendUtf8To(out, code);
+}
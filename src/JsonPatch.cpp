@@ -0,0 +1,687 @@
+#include "../include/JsonPatch.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+    using Path = JsonPatch::Path;
+    using Component = Path::value_type;
+
+    // Index of an array named by a component, "-" is the end when allowed
+    bool arrayIndex(const Component& component, std::size_t size, bool allowEnd, std::size_t& index) {
+        if (const std::size_t* value = std::get_if<std::size_t>(&component)) {
+            index = *value;
+            return true;
+        }
+
+        const std::string& text = std::get<std::string>(component);
+        if (text == "-") {
+            index = size;
+            return allowEnd;
+        }
+        if (text.empty() || text.size() > 19) {
+            return false;
+        }
+
+        index = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            index = index * 10 + std::size_t(c - '0');
+        }
+        return true;
+    }
+
+    // Key of an object named by a component
+    std::string objectKey(const Component& component) {
+        if (const std::size_t* value = std::get_if<std::size_t>(&component)) {
+            return std::to_string(*value);
+        }
+        return std::get<std::string>(component);
+    }
+
+    // Member / element of node named by a component, nullptr if there is none
+    JsonValue* childOf(JsonValue& node, const Component& component) {
+        if (node.isArray()) {
+            JsonValue::JsonArray& arr = node.getAsArray();
+            std::size_t index;
+            return arrayIndex(component, arr.size(), false, index) && index < arr.size() ? &arr[index] : nullptr;
+        }
+
+        if (node.isObject()) {
+            JsonValue::JsonObject& obj = node.getAsObject();
+            const std::string* key = std::get_if<std::string>(&component);
+            const auto it = key != nullptr ? obj.find(*key) : obj.find(objectKey(component));
+            return it != obj.end() ? &it->second : nullptr;
+        }
+
+        return nullptr;
+    }
+
+    // Order used to group operations, digit keys compare as the index they may stand for.
+    // Returns <0, 0 or >0, and sets prefix when the shorter path is a prefix of the longer one.
+    int comparePaths(const Path& a, const Path& b, bool& prefix) {
+        const std::size_t common = std::min(a.size(), b.size());
+        for (std::size_t i = 0; i < common; ++i) {
+            std::size_t left = 0;
+            std::size_t right = 0;
+            const bool leftIndex = arrayIndex(a[i], 0, false, left);
+            const bool rightIndex = arrayIndex(b[i], 0, false, right);
+
+            if (leftIndex != rightIndex) {
+                prefix = false;
+                return leftIndex ? -1 : 1;
+            }
+            if (leftIndex ? left != right : std::get<std::string>(a[i]) != std::get<std::string>(b[i])) {
+                prefix = false;
+                return leftIndex ? (left < right ? -1 : 1) : std::get<std::string>(a[i]).compare(std::get<std::string>(b[i]));
+            }
+        }
+
+        prefix = true;
+        return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+    }
+
+    bool isPrefix(const Path& prefix, const Path& path) {
+        bool isPrefix = false;
+        comparePaths(prefix, path, isPrefix);
+        return isPrefix && prefix.size() <= path.size();
+    }
+
+    // Operations turning from into to, appended to patch. Subtrees with the same hash are taken as equal
+    // and skipped, and arrays are only compared between their common first and last elements.
+    void diffValues(JsonPatch& patch, Path& path, const JsonValue& from, const JsonValue& to) {
+        if (from.isObject() && to.isObject()) {
+            if (from.hash() == to.hash()) {
+                return;
+            }
+
+            const JsonValue::JsonObject& left = from.getAsObject();
+            const JsonValue::JsonObject& right = to.getAsObject();
+            for (const auto& member : left) {
+                const auto it = right.find(member.first, member.first.hash());
+                path.emplace_back(std::string(member.first.view()));
+                if (it == right.end()) {
+                    patch.remove(path);
+                } else {
+                    diffValues(patch, path, member.second, it->second);
+                }
+                path.pop_back();
+            }
+            for (const auto& member : right) {
+                if (left.find(member.first, member.first.hash()) == left.end()) {
+                    path.emplace_back(std::string(member.first.view()));
+                    patch.add(path, JsonValue(member.second));
+                    path.pop_back();
+                }
+            }
+            return;
+        }
+
+        if (from.isArray() && to.isArray()) {
+            if (from.hash() == to.hash()) {
+                return;
+            }
+
+            const JsonValue::JsonArray& left = from.getAsArray();
+            const JsonValue::JsonArray& right = to.getAsArray();
+            const std::size_t shorter = std::min(left.size(), right.size());
+
+            // Unchanged elements at both ends, so an insertion or removal shows as just that
+            std::size_t first = 0;
+            while (first < shorter && left[first].hash() == right[first].hash()) {
+                first++;
+            }
+            std::size_t last = 0;
+            while (last < shorter - first && left[left.size() - 1 - last].hash() == right[right.size() - 1 - last].hash()) {
+                last++;
+            }
+
+            const std::size_t leftEnd = left.size() - last;
+            const std::size_t rightEnd = right.size() - last;
+            const std::size_t paired = std::min(leftEnd, rightEnd);
+
+            for (std::size_t i = first; i < paired; ++i) {
+                path.emplace_back(i);
+                diffValues(patch, path, left[i], right[i]);
+                path.pop_back();
+            }
+            // Removed from the end backwards so the indices still to remove do not move
+            for (std::size_t i = leftEnd; i-- > paired;) {
+                path.emplace_back(i);
+                patch.remove(path);
+                path.pop_back();
+            }
+            for (std::size_t i = paired; i < rightEnd; ++i) {
+                path.emplace_back(i);
+                patch.add(path, JsonValue(right[i]));
+                path.pop_back();
+            }
+            return;
+        }
+
+        if (from != to) {
+            patch.replace(path, JsonValue(to));
+        }
+    }
+
+    [[noreturn]] void pathNotFound(const Path& path) {
+        throw std::runtime_error("Path not found: " + JsonPatch::toPointer(path));
+    }
+
+    // Applies operations to one document, keeps the values on the path of the previous operation
+    // so the next one only walks from where the paths differ, and records how to undo each change.
+    class PatchApplier {
+
+    private:
+        // Change to revert. The parent is given by the first depth components of the path of the
+        // operation, since the nodes may have moved since, and the member by the last component.
+        struct Undo {
+            enum class Kind {
+                RemoveMember,
+                RemoveElement,
+                RestoreMember,
+                RestoreElement,
+                RestoreValue,
+                RestoreRoot
+            };
+
+            Kind kind;
+            const Path* path;
+            std::size_t depth;
+            std::size_t position; // array index, or member position to restore
+            JsonValue value;
+        };
+
+        JsonValue& root;
+        bool recordUndo;
+        std::vector<Undo> undoLog;
+
+        // nodes[i] is the value reached by the first i components of the path of the last walk
+        std::vector<JsonValue*> nodes;
+        const Path* cached = nullptr;
+
+    public:
+
+        PatchApplier(JsonValue& root, bool recordUndo) : root(root), recordUndo(recordUndo), nodes{&root} {}
+
+        void apply(const JsonPatch::Operation& operation) {
+            switch (operation.op) {
+                case JsonPatch::Op::Add:
+                    add(operation.path, JsonValue(operation.value));
+                    break;
+
+                case JsonPatch::Op::Remove:
+                    remove(operation.path, false);
+                    break;
+
+                case JsonPatch::Op::Replace:
+                    replace(operation.path, JsonValue(operation.value));
+                    break;
+
+                case JsonPatch::Op::Move:
+                    if (operation.from != operation.path) {
+                        if (operation.from.size() < operation.path.size() && isPrefix(operation.from, operation.path)) {
+                            throw std::runtime_error("Cannot move a value into itself: " + JsonPatch::toPointer(operation.path));
+                        }
+                        add(operation.path, remove(operation.from, true));
+                    }
+                    break;
+
+                case JsonPatch::Op::Copy:
+                    add(operation.path, JsonValue(resolve(operation.from, operation.from.size())));
+                    break;
+
+                case JsonPatch::Op::Test:
+                    if (resolve(operation.path, operation.path.size()) != operation.value) {
+                        throw std::runtime_error("Test failed at " + JsonPatch::toPointer(operation.path));
+                    }
+                    break;
+            }
+        }
+
+        // Apply the removes of members of one object starting at operations[first] as one batch, the object being
+        // compacted once instead of once per member. Returns the number of operations applied, 0 when there is
+        // no such run or one of its keys is missing or repeated, the operations then go one by one and fail as usual.
+        std::size_t removeMembers(const std::vector<JsonPatch::Operation>& operations, std::size_t first) {
+            const Path& path = operations[first].path;
+            auto sameParent = [&path](const JsonPatch::Operation& operation) {
+                return operation.op == JsonPatch::Op::Remove && !path.empty() && operation.path.size() == path.size()
+                    && std::holds_alternative<std::string>(operation.path.back())
+                    && std::equal(path.begin(), path.end() - 1, operation.path.begin());
+            };
+
+            std::size_t last = first;
+            while (last < operations.size() && sameParent(operations[last])) {
+                last++;
+            }
+            if (last - first < 2) {
+                return 0;
+            }
+
+            const std::size_t depth = path.size() - 1;
+            JsonValue& parent = resolve(path, depth);
+            if (!parent.isObject()) {
+                return 0;
+            }
+
+            JsonValue::JsonObject& obj = parent.getAsObject();
+            std::vector<std::string_view> keys;
+            std::vector<std::size_t> positions;
+            std::vector<bool> seen(obj.size());
+            for (std::size_t i = first; i < last; ++i) {
+                keys.emplace_back(std::get<std::string>(operations[i].path.back()));
+                const auto it = obj.find(keys.back());
+                if (it == obj.end() || seen[std::size_t(it - obj.begin())]) {
+                    return 0;
+                }
+                positions.push_back(std::size_t(it - obj.begin()));
+                seen[positions.back()] = true;
+            }
+
+            // Undo restores each member where it was when its own remove came, after the ones removed before it
+            if (recordUndo) {
+                std::vector<std::size_t> earlier;
+                for (std::size_t i = 0; i < positions.size(); ++i) {
+                    const auto at = std::lower_bound(earlier.begin(), earlier.end(), positions[i]);
+                    record(Undo::Kind::RestoreMember, operations[first + i].path, positions[i] - std::size_t(at - earlier.begin()),
+                           std::move((obj.begin() + std::ptrdiff_t(positions[i]))->second));
+                    earlier.insert(at, positions[i]);
+                }
+            }
+            obj.erase(keys);
+
+            truncate(depth);
+            return last - first;
+        }
+
+        // Revert every change, latest first
+        void rollback() {
+            for (auto it = undoLog.rbegin(); it != undoLog.rend(); ++it) {
+                Undo& undo = *it;
+                if (undo.kind == Undo::Kind::RestoreRoot) {
+                    root = std::move(undo.value);
+                    continue;
+                }
+
+                JsonValue* parent = &root;
+                for (std::size_t i = 0; i < undo.depth; ++i) {
+                    parent = childOf(*parent, (*undo.path)[i]);
+                }
+                const std::string key = parent->isObject() ? objectKey(undo.path->back()) : std::string();
+
+                switch (undo.kind) {
+                    case Undo::Kind::RemoveMember:
+                        parent->getAsObject().erase(key);
+                        break;
+                    case Undo::Kind::RemoveElement:
+                        parent->getAsArray().erase(parent->getAsArray().begin() + std::ptrdiff_t(undo.position));
+                        break;
+                    case Undo::Kind::RestoreMember: {
+                        JsonValue::JsonObject& obj = parent->getAsObject();
+                        obj.insert(obj.begin() + std::ptrdiff_t(undo.position),
+                                   JsonKey(key, obj.get_allocator()), std::move(undo.value));
+                        break;
+                    }
+                    case Undo::Kind::RestoreElement: {
+                        JsonValue::JsonArray& arr = parent->getAsArray();
+                        arr.insert(arr.begin() + std::ptrdiff_t(undo.position), std::move(undo.value));
+                        break;
+                    }
+                    case Undo::Kind::RestoreValue:
+                        if (parent->isArray()) {
+                            parent->getAsArray()[undo.position] = std::move(undo.value);
+                        } else {
+                            parent->getAsObject().find(key)->second = std::move(undo.value);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+
+            undoLog.clear();
+            nodes.resize(1);
+        }
+
+    private:
+
+        // Value reached by the first depth components of path, starting from the shared prefix with the last walk
+        JsonValue& resolve(const Path& path, std::size_t depth) {
+            std::size_t shared = 0;
+            if (cached != nullptr) {
+                const std::size_t limit = std::min({depth, nodes.size() - 1, cached->size()});
+                while (shared < limit && path[shared] == (*cached)[shared]) {
+                    shared++;
+                }
+            }
+            nodes.resize(shared + 1);
+
+            for (std::size_t i = shared; i < depth; ++i) {
+                JsonValue* child = childOf(*nodes.back(), path[i]);
+                if (child == nullptr) {
+                    pathNotFound(Path(path.begin(), path.begin() + std::ptrdiff_t(i) + 1));
+                }
+                nodes.push_back(child);
+            }
+
+            cached = &path;
+            return *nodes[depth];
+        }
+
+        // Forget the values below depth, they may have moved
+        void truncate(std::size_t depth) {
+            nodes.resize(std::min(nodes.size(), depth + 1));
+        }
+
+        void record(Undo::Kind kind, const Path& path, std::size_t position, JsonValue&& value) {
+            if (recordUndo) {
+                undoLog.push_back({kind, &path, path.size() - 1, position, std::move(value)});
+            }
+        }
+
+        void replaceRoot(JsonValue&& value) {
+            // Placed in the resource of the old root, e.g. the arena of a document
+            JsonValue next(std::move(value), root.getAllocator());
+            if (recordUndo) {
+                undoLog.push_back({Undo::Kind::RestoreRoot, nullptr, 0, 0, std::move(root)});
+            }
+            root = std::move(next);
+            truncate(0);
+        }
+
+        void add(const Path& path, JsonValue&& value) {
+            if (path.empty()) {
+                replaceRoot(std::move(value));
+                return;
+            }
+
+            const std::size_t depth = path.size() - 1;
+            JsonValue& parent = resolve(path, depth);
+
+            if (parent.isObject()) {
+                JsonValue::JsonObject& obj = parent.getAsObject();
+                std::string key = objectKey(path.back());
+                const auto it = obj.find(key);
+                if (it != obj.end()) {
+                    record(Undo::Kind::RestoreValue, path, 0, std::move(it->second));
+                    it->second = JsonValue(std::move(value), parent.getAllocator());
+                } else {
+                    obj.insert_or_assign(JsonKey(key, obj.get_allocator()), std::move(value));
+                    record(Undo::Kind::RemoveMember, path, 0, JsonValue());
+                }
+            } else if (parent.isArray()) {
+                JsonValue::JsonArray& arr = parent.getAsArray();
+                std::size_t index;
+                if (!arrayIndex(path.back(), arr.size(), true, index) || index > arr.size()) {
+                    pathNotFound(path);
+                }
+                arr.insert(arr.begin() + std::ptrdiff_t(index), std::move(value));
+                record(Undo::Kind::RemoveElement, path, index, JsonValue());
+            } else {
+                pathNotFound(path);
+            }
+
+            // The parent kept its place, what was below it may have moved
+            truncate(depth);
+        }
+
+        // The removed value is returned when keep is set, a copy of it is then kept for undo
+        JsonValue remove(const Path& path, bool keep) {
+            if (path.empty()) {
+                throw std::runtime_error("Cannot remove the root of the document");
+            }
+
+            const std::size_t depth = path.size() - 1;
+            JsonValue& parent = resolve(path, depth);
+            JsonValue removed;
+
+            if (parent.isObject()) {
+                JsonValue::JsonObject& obj = parent.getAsObject();
+                std::string key = objectKey(path.back());
+                const auto it = obj.find(key);
+                if (it == obj.end()) {
+                    pathNotFound(path);
+                }
+                const std::size_t position = std::size_t(it - obj.begin());
+                removed = std::move(it->second);
+                obj.erase(key);
+                if (recordUndo) {
+                    record(Undo::Kind::RestoreMember, path, position, keep ? JsonValue(removed) : std::move(removed));
+                }
+            } else if (parent.isArray()) {
+                JsonValue::JsonArray& arr = parent.getAsArray();
+                std::size_t index;
+                if (!arrayIndex(path.back(), arr.size(), false, index) || index >= arr.size()) {
+                    pathNotFound(path);
+                }
+                removed = std::move(arr[index]);
+                arr.erase(arr.begin() + std::ptrdiff_t(index));
+                if (recordUndo) {
+                    record(Undo::Kind::RestoreElement, path, index, keep ? JsonValue(removed) : std::move(removed));
+                }
+            } else {
+                pathNotFound(path);
+            }
+
+            truncate(depth);
+            return removed;
+        }
+
+        void replace(const Path& path, JsonValue&& value) {
+            if (path.empty()) {
+                replaceRoot(std::move(value));
+                return;
+            }
+
+            JsonValue& target = resolve(path, path.size());
+            const std::size_t depth = path.size() - 1;
+            const JsonValue& parent = *nodes[depth];
+
+            if (recordUndo) {
+                std::size_t index = 0;
+                if (parent.isArray()) {
+                    arrayIndex(path.back(), 0, false, index);
+                }
+                record(Undo::Kind::RestoreValue, path, index, std::move(target));
+            }
+            target = JsonValue(std::move(value), parent.getAllocator());
+
+            // The target stays where it is, the values below it are gone
+            truncate(path.size());
+        }
+    };
+
+    std::string requireString(const JsonValue& operation, std::string_view member) {
+        if (!operation.isObject() || !operation.getAsObject().contains(member) || !operation[member].isString()) {
+            throw std::runtime_error("Invalid JSON Patch: missing \"" + std::string(member) + "\"");
+        }
+        return std::string(operation[member].getAsStringView());
+    }
+
+    const JsonValue& requireValue(const JsonValue& operation) {
+        if (!operation.getAsObject().contains("value")) {
+            throw std::runtime_error("Invalid JSON Patch: missing \"value\"");
+        }
+        return operation["value"];
+    }
+}
+
+JsonPatch::JsonPatch(const JsonValue &patch) {
+    if (!patch.isArray()) {
+        throw std::runtime_error("Invalid JSON Patch: expected an array of operations");
+    }
+
+    for (const JsonValue& operation : patch.getAsArray()) {
+        const std::string op = requireString(operation, "op");
+        Path path = parsePointer(requireString(operation, "path"));
+
+        if (op == "add") {
+            add(std::move(path), JsonValue(requireValue(operation)));
+        } else if (op == "remove") {
+            remove(std::move(path));
+        } else if (op == "replace") {
+            replace(std::move(path), JsonValue(requireValue(operation)));
+        } else if (op == "move") {
+            move(parsePointer(requireString(operation, "from")), std::move(path));
+        } else if (op == "copy") {
+            copy(parsePointer(requireString(operation, "from")), std::move(path));
+        } else if (op == "test") {
+            test(std::move(path), JsonValue(requireValue(operation)));
+        } else {
+            throw std::runtime_error("Invalid JSON Patch: unknown operation \"" + op + "\"");
+        }
+    }
+}
+
+JsonPatch& JsonPatch::add(Path path, JsonValue &&value) {
+    operations.push_back({Op::Add, std::move(path), {}, std::move(value)});
+    return *this;
+}
+
+JsonPatch& JsonPatch::remove(Path path) {
+    operations.push_back({Op::Remove, std::move(path), {}, JsonValue()});
+    return *this;
+}
+
+JsonPatch& JsonPatch::replace(Path path, JsonValue &&value) {
+    operations.push_back({Op::Replace, std::move(path), {}, std::move(value)});
+    return *this;
+}
+
+JsonPatch& JsonPatch::move(Path from, Path path) {
+    operations.push_back({Op::Move, std::move(path), std::move(from), JsonValue()});
+    return *this;
+}
+
+JsonPatch& JsonPatch::copy(Path from, Path path) {
+    operations.push_back({Op::Copy, std::move(path), std::move(from), JsonValue()});
+    return *this;
+}
+
+JsonPatch& JsonPatch::test(Path path, JsonValue &&value) {
+    operations.push_back({Op::Test, std::move(path), {}, std::move(value)});
+    return *this;
+}
+
+const std::vector<JsonPatch::Operation>& JsonPatch::getOperations() const {
+    return operations;
+}
+
+JsonPatch& JsonPatch::sortByPath() {
+    // Replace and test change no structure, and removing an object member changes the path of no other
+    // value, so a run of them can be applied in any order as long as no path of the
+    // run is inside another one. A component that can be an index may name an array element, whose removal
+    // shifts the ones after it, and add is left out since where a member is added depends on the order.
+    auto isValueOp = [](const Operation& operation) {
+        if (operation.path.empty()) {
+            return false;
+        }
+        std::size_t index;
+        return operation.op == Op::Replace || operation.op == Op::Test
+            || (operation.op == Op::Remove && !arrayIndex(operation.path.back(), 0, false, index));
+    };
+
+    for (auto begin = operations.begin(); begin != operations.end();) {
+        const auto end = std::find_if_not(begin, operations.end(), isValueOp);
+
+        if (end - begin > 1) {
+            std::vector<std::size_t> run(std::size_t(end - begin));
+            std::iota(run.begin(), run.end(), std::size_t(0));
+            std::stable_sort(run.begin(), run.end(), [begin](std::size_t a, std::size_t b) {
+                bool prefix;
+                return comparePaths(begin[std::ptrdiff_t(a)].path, begin[std::ptrdiff_t(b)].path, prefix) < 0;
+            });
+
+            // Sorted, a path inside another one comes right after it
+            bool nested = false;
+            for (std::size_t i = 1; i < run.size() && !nested; ++i) {
+                const Path& previous = begin[std::ptrdiff_t(run[i - 1])].path;
+                const Path& current = begin[std::ptrdiff_t(run[i])].path;
+                nested = previous.size() < current.size() && isPrefix(previous, current);
+            }
+
+            if (!nested) {
+                std::vector<Operation> sorted;
+                sorted.reserve(run.size());
+                for (std::size_t i : run) {
+                    sorted.push_back(std::move(begin[std::ptrdiff_t(i)]));
+                }
+                std::move(sorted.begin(), sorted.end(), begin);
+            }
+        }
+
+        begin = end == begin ? end + 1 : end;
+    }
+    return *this;
+}
+
+void JsonPatch::apply(JsonValue &target, bool atomic) const {
+    PatchApplier applier(target, atomic);
+    try {
+        for (std::size_t i = 0; i < operations.size();) {
+            const std::size_t batch = applier.removeMembers(operations, i);
+            if (batch == 0) {
+                applier.apply(operations[i++]);
+            }
+            i += batch;
+        }
+    } catch (...) {
+        if (atomic) {
+            applier.rollback();
+        }
+        throw;
+    }
+}
+
+JsonPatch JsonPatch::diff(const JsonValue &from, const JsonValue &to) {
+    JsonPatch patch;
+    Path path;
+    diffValues(patch, path, from, to);
+    return patch;
+}
+
+JsonPatch::Path JsonPatch::parsePointer(std::string_view pointer) {
+    Path path;
+    if (pointer.empty()) {
+        return path;
+    }
+    if (pointer[0] != '/') {
+        throw std::runtime_error("Invalid JSON Pointer: " + std::string(pointer));
+    }
+
+    std::string component;
+    for (std::size_t i = 1; i <= pointer.size(); ++i) {
+        if (i == pointer.size() || pointer[i] == '/') {
+            path.emplace_back(std::move(component));
+            component.clear();
+        } else if (pointer[i] == '~') {
+            // ~0 is '~' and ~1 is '/'
+            if (i + 1 == pointer.size() || (pointer[i + 1] != '0' && pointer[i + 1] != '1')) {
+                throw std::runtime_error("Invalid JSON Pointer: " + std::string(pointer));
+            }
+            component.push_back(pointer[++i] == '0' ? '~' : '/');
+        } else {
+            component.push_back(pointer[i]);
+        }
+    }
+    return path;
+}
+
+std::string JsonPatch::toPointer(const Path &path) {
+    std::string pointer;
+    for (const Component& component : path) {
+        pointer.push_back('/');
+        for (char c : objectKey(component)) {
+            if (c == '~') {
+                pointer.append("~0");
+            } else if (c == '/') {
+                pointer.append("~1");
+            } else {
+                pointer.push_back(c);
+            }
+        }
+    }
+    return pointer;
+}
@@ -0,0 +1,256 @@
+#include "../include/JsonPath.h"
+#include <algorithm>
+
+namespace {
+
+    [[noreturn]] void invalidPath(std::string_view expression) {
+        throw std::runtime_error("Invalid JSON path: " + std::string(expression));
+    }
+
+    // Name after a dot, up to the next dot or bracket
+    std::string readName(std::string_view expression, std::size_t &i) {
+        const std::size_t start = i;
+        while (i < expression.size() && expression[i] != '.' && expression[i] != '[') {
+            i++;
+        }
+        if (i == start) {
+            invalidPath(expression);
+        }
+        return std::string(expression.substr(start, i - start));
+    }
+
+    // Quoted name inside brackets, i points at the opening quote
+    std::string readQuoted(std::string_view expression, std::size_t &i) {
+        const char quote = expression[i++];
+        std::string name;
+        while (i < expression.size() && expression[i] != quote) {
+            if (expression[i] == '\\' && i + 1 < expression.size()) {
+                i++;
+            }
+            name.push_back(expression[i++]);
+        }
+        if (i == expression.size()) {
+            invalidPath(expression);
+        }
+        i++; // Skip the closing quote
+        return name;
+    }
+}
+
+JsonPath::JsonPath(std::string_view expression) {
+    std::size_t i = 0;
+
+    if (!expression.empty() && expression[0] == '$') {
+        i = 1;
+    } else if (!expression.empty() && expression[0] != '.' && expression[0] != '[') {
+        // A leading name without "$."
+        steps.push_back({Step::Kind::Key, false, readName(expression, i)});
+    }
+
+    while (i < expression.size()) {
+        bool recursive = false;
+
+        if (expression[i] == '.') {
+            recursive = i + 1 < expression.size() && expression[i + 1] == '.';
+            i += recursive ? 2 : 1;
+            if (i == expression.size()) {
+                invalidPath(expression);
+            }
+
+            if (expression[i] == '*') {
+                steps.push_back({Step::Kind::Wildcard, recursive, {}});
+                i++;
+                continue;
+            }
+            if (expression[i] != '[') {
+                steps.push_back({Step::Kind::Key, recursive, readName(expression, i)});
+                continue;
+            }
+            if (!recursive) {
+                invalidPath(expression); // ".[" is not valid, "..[" is
+            }
+        }
+
+        if (expression[i] != '[' || ++i == expression.size()) {
+            invalidPath(expression);
+        }
+
+        if (expression[i] == '*') {
+            steps.push_back({Step::Kind::Wildcard, recursive, {}});
+            i++;
+        } else if (expression[i] == '\'' || expression[i] == '"') {
+            steps.push_back({Step::Kind::Key, recursive, readQuoted(expression, i)});
+        } else {
+            const std::size_t start = i;
+            std::size_t index = 0;
+            while (i < expression.size() && expression[i] >= '0' && expression[i] <= '9') {
+                index = index * 10 + std::size_t(expression[i++] - '0');
+            }
+            if (i == start) {
+                invalidPath(expression);
+            }
+            steps.push_back({Step::Kind::Index, recursive, {}, 0, index});
+        }
+
+        if (i == expression.size() || expression[i] != ']') {
+            invalidPath(expression);
+        }
+        i++; // Skip the closing bracket
+    }
+
+    for (Step& step : steps) {
+        if (step.kind == Step::Kind::Key) {
+            step.hash = JsonObject::hashKey(step.key);
+        }
+    }
+}
+
+JsonPath::JsonPath(const JsonValue::pathInJson &path) {
+    for (const auto& component : path) {
+        if (const std::size_t* index = std::get_if<std::size_t>(&component)) {
+            steps.push_back({Step::Kind::Index, false, {}, 0, *index});
+        } else {
+            const std::string& key = std::get<std::string>(component);
+            steps.push_back({Step::Kind::Key, false, key, JsonObject::hashKey(key)});
+        }
+    }
+}
+
+std::vector<const JsonValue*> JsonPath::select(const JsonValue &root) const {
+    std::vector<const JsonValue*> matches;
+    auto visit = [&matches](const JsonValue& value) {
+        matches.push_back(&value);
+        return true;
+    };
+    evaluate(0, root, visit);
+    return matches;
+}
+
+std::vector<JsonValue*> JsonPath::select(JsonValue &root) const {
+    std::vector<JsonValue*> matches;
+    auto visit = [&matches](JsonValue& value) {
+        matches.push_back(&value);
+        return true;
+    };
+    evaluate(0, root, visit);
+    return matches;
+}
+
+const JsonValue* JsonPath::selectFirst(const JsonValue &root) const {
+    const JsonValue* match = nullptr;
+    auto visit = [&match](const JsonValue& value) {
+        match = &value;
+        return false;
+    };
+    evaluate(0, root, visit);
+    return match;
+}
+
+JsonValue* JsonPath::selectFirst(JsonValue &root) const {
+    JsonValue* match = nullptr;
+    auto visit = [&match](JsonValue& value) {
+        match = &value;
+        return false;
+    };
+    evaluate(0, root, visit);
+    return match;
+}
+
+bool JsonPath::matches(const JsonValue::pathInJson &path) const {
+    return matchFrom(0, 0, path);
+}
+
+template <typename Value, typename Visit>
+bool JsonPath::evaluate(std::size_t step, Value &node, Visit &visit) const {
+    if (step == steps.size()) {
+        return visit(node);
+    }
+    return steps[step].recursive ? descend(step, node, visit) : applyStep(step, node, visit);
+}
+
+template <typename Value, typename Visit>
+bool JsonPath::applyStep(std::size_t step, Value &node, Visit &visit) const {
+    const Step& current = steps[step];
+
+    if (node.isObject()) {
+        auto& obj = node.getAsObject();
+        if (current.kind == Step::Kind::Key) {
+            const auto it = obj.find(current.key, current.hash);
+            return it == obj.end() || evaluate(step + 1, it->second, visit);
+        }
+        if (current.kind == Step::Kind::Wildcard) {
+            for (auto& member : obj) {
+                if (!evaluate(step + 1, member.second, visit)) {
+                    return false;
+                }
+            }
+        }
+    } else if (node.isArray()) {
+        auto& arr = node.getAsArray();
+        if (current.kind == Step::Kind::Index) {
+            return current.index >= arr.size() || evaluate(step + 1, arr[current.index], visit);
+        }
+        if (current.kind == Step::Kind::Wildcard) {
+            for (Value& element : arr) {
+                if (!evaluate(step + 1, element, visit)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Value, typename Visit>
+bool JsonPath::descend(std::size_t step, Value &node, Visit &visit) const {
+    // The step applies to the children of node, then to the children of every value below it
+    if (!applyStep(step, node, visit)) {
+        return false;
+    }
+
+    if (node.isObject()) {
+        for (auto& member : node.getAsObject()) {
+            if (!descend(step, member.second, visit)) {
+                return false;
+            }
+        }
+    } else if (node.isArray()) {
+        for (Value& element : node.getAsArray()) {
+            if (!descend(step, element, visit)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool JsonPath::matchFrom(std::size_t step, std::size_t position, const JsonValue::pathInJson &path) const {
+    if (step == steps.size()) {
+        return position == path.size();
+    }
+
+    const Step& current = steps[step];
+    auto matchesComponent = [&current](const std::variant<std::size_t, std::string>& component) {
+        switch (current.kind) {
+            case Step::Kind::Key: {
+                const std::string* key = std::get_if<std::string>(&component);
+                return key != nullptr && *key == current.key;
+            }
+            case Step::Kind::Index: {
+                const std::size_t* index = std::get_if<std::size_t>(&component);
+                return index != nullptr && *index == current.index;
+            }
+            default:
+                return true;
+        }
+    };
+
+    // A recursive step may skip any number of levels first
+    const std::size_t last = current.recursive ? path.size() : std::min(position + 1, path.size());
+    for (std::size_t i = position; i < last; ++i) {
+        if (matchesComponent(path[i]) && matchFrom(step + 1, i + 1, path)) {
+            return true;
+        }
+    }
+    return false;
+}
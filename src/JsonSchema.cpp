@@ -0,0 +1,805 @@
+#include "../include/JsonSchema.h"
+#include "../include/JsonKey.h"
+#include "../include/JsonWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+    [[noreturn]] void invalidSchema(const std::string& message) {
+        throw std::runtime_error("Invalid JSON schema: " + message);
+    }
+
+    // Keywords of draft 2020-12 that this compiler does not handle
+    const char* const unsupportedKeywords[] = {
+        "allOf", "anyOf", "oneOf", "not", "if", "then", "else", "dependentSchemas", "dependentRequired",
+        "dependencies", "patternProperties", "propertyNames", "pattern", "uniqueItems", "contains",
+        "minContains", "maxContains", "unevaluatedProperties", "unevaluatedItems", "$dynamicRef", "$recursiveRef"
+    };
+
+    // Keywords that constrain a value, which cannot sit next to a $ref here
+    const char* const constraintKeywords[] = {
+        "type", "enum", "const", "minimum", "maximum", "exclusiveMinimum", "exclusiveMaximum", "multipleOf",
+        "minLength", "maxLength", "properties", "required", "additionalProperties", "minProperties",
+        "maxProperties", "prefixItems", "items", "additionalItems", "minItems", "maxItems"
+    };
+
+    double numberOf(const JsonValue& value, const char* keyword) {
+        if (!value.isNumber()) {
+            invalidSchema(std::string(keyword) + " must be a number");
+        }
+        return value.getAsNumber();
+    }
+
+    std::size_t countOf(const JsonValue& value, const char* keyword) {
+        const double count = value.isNumber() ? value.getAsNumber() : -1;
+        if (count < 0 || std::floor(count) != count) {
+            invalidSchema(std::string(keyword) + " must be a non-negative integer");
+        }
+        return count >= double(SIZE_MAX) ? SIZE_MAX : std::size_t(count);
+    }
+
+    bool isIntegral(double value) {
+        return std::isfinite(value) && std::floor(value) == value;
+    }
+
+    // Sign of exact - num, with no rounding of the integer
+    int compareExact(const JsonValue& exact, double num) {
+        if (num >= 0x1p64) {
+            return -1;
+        }
+        if (num < -0x1p63) {
+            return 1;
+        }
+        const double whole = std::trunc(num);
+        const int fraction = num > whole ? -1 : num < whole ? 1 : 0;
+        if (exact.isUnsigned()) {
+            if (num < 0) {
+                return 1;
+            }
+            const JsonValue::JsonUnsigned bound = JsonValue::JsonUnsigned(whole);
+            return exact.getAsUnsigned() < bound ? -1 : exact.getAsUnsigned() > bound ? 1 : fraction;
+        }
+        if (whole >= 0x1p63) {
+            return -1;
+        }
+        const JsonValue::JsonInteger bound = JsonValue::JsonInteger(whole);
+        return exact.getAsInteger() < bound ? -1 : exact.getAsInteger() > bound ? 1 : fraction;
+    }
+
+    // Sign of a - b for two numbers, integers being compared exactly
+    int compareNumbers(const JsonValue& a, const JsonValue& b) {
+        const bool aExact = a.isInteger() || a.isUnsigned();
+        const bool bExact = b.isInteger() || b.isUnsigned();
+        if (aExact && bExact) {
+            if (a.isUnsigned() != b.isUnsigned()) {
+                // The parser only makes unsigned values above the JsonInteger range
+                const JsonValue& signedValue = a.isUnsigned() ? b : a;
+                const JsonValue& unsignedValue = a.isUnsigned() ? a : b;
+                const int sign = signedValue.getAsInteger() < 0
+                    || JsonValue::JsonUnsigned(signedValue.getAsInteger()) < unsignedValue.getAsUnsigned() ? -1
+                    : JsonValue::JsonUnsigned(signedValue.getAsInteger()) > unsignedValue.getAsUnsigned() ? 1 : 0;
+                return a.isUnsigned() ? -sign : sign;
+            }
+            if (a.isUnsigned()) {
+                return a.getAsUnsigned() < b.getAsUnsigned() ? -1 : a.getAsUnsigned() > b.getAsUnsigned() ? 1 : 0;
+            }
+            return a.getAsInteger() < b.getAsInteger() ? -1 : a.getAsInteger() > b.getAsInteger() ? 1 : 0;
+        }
+        if (aExact) {
+            return compareExact(a, b.getAsNumber());
+        }
+        if (bExact) {
+            return -compareExact(b, a.getAsNumber());
+        }
+        return a.getAsNumber() < b.getAsNumber() ? -1 : a.getAsNumber() > b.getAsNumber() ? 1 : 0;
+    }
+
+    // Magnitude of an integral value that fits a JsonUnsigned, false for any other
+    bool integralMagnitude(const JsonValue& value, JsonValue::JsonUnsigned& magnitude) {
+        if (value.isUnsigned()) {
+            magnitude = value.getAsUnsigned();
+            return true;
+        }
+        if (value.isInteger()) {
+            const JsonValue::JsonInteger integer = value.getAsInteger();
+            magnitude = integer < 0 ? 0 - JsonValue::JsonUnsigned(integer) : JsonValue::JsonUnsigned(integer);
+            return true;
+        }
+        const double number = std::fabs(value.getAsNumber());
+        if (!isIntegral(number) || number >= 0x1p64) {
+            return false;
+        }
+        magnitude = JsonValue::JsonUnsigned(number);
+        return true;
+    }
+
+    // Integers are divided exactly. Otherwise the quotient is rounded, 0.3 / 0.1 gives 2.9999999999999996,
+    // so it is a multiple when within a few units in the last place of an integer.
+    bool isMultiple(const JsonValue& value, const JsonValue& divisor) {
+        JsonValue::JsonUnsigned valueMagnitude = 0, divisorMagnitude = 0;
+        if (integralMagnitude(value, valueMagnitude) && integralMagnitude(divisor, divisorMagnitude)) {
+            return valueMagnitude % divisorMagnitude == 0;
+        }
+        const double quotient = value.getAsNumber() / divisor.getAsNumber();
+        if (!std::isfinite(quotient)) {
+            return false;
+        }
+        const double error = std::fabs(quotient - std::round(quotient));
+        return error <= 16 * std::numeric_limits<double>::epsilon() * std::max(1.0, std::fabs(quotient));
+    }
+
+    // Code points of UTF-8 text: every byte that does not continue a sequence starts one
+    std::size_t codePoints(std::string_view str) {
+        std::size_t count = 0;
+        for (const char c : str) {
+            count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+        }
+        return count;
+    }
+
+    // Same events as parsing the text of the value
+    void replay(const JsonValue& value, JsonHandler& handler) {
+        if (value.isObject()) {
+            handler.startObject();
+            for (const auto& member : value.getAsObject()) {
+                handler.key(member.first);
+                replay(member.second, handler);
+            }
+            handler.endObject();
+        } else if (value.isArray()) {
+            handler.startArray();
+            for (const JsonValue& element : value.getAsArray()) {
+                replay(element, handler);
+            }
+            handler.endArray();
+        } else if (value.isString()) {
+            handler.string(value.getAsStringView());
+        } else if (value.isInteger()) {
+            handler.integer(value.getAsInteger());
+        } else if (value.isUnsigned()) {
+            handler.unsignedInteger(value.getAsUnsigned());
+        } else if (value.isNumber()) {
+            handler.number(value.getAsNumber());
+        } else if (value.isBool()) {
+            handler.boolean(value.getAsBool());
+        } else {
+            handler.null();
+        }
+    }
+}
+
+
+// Turns the subschemas into nodes, references being compiled once per pointer
+class JsonSchema::Compiler {
+
+private:
+    JsonSchema& schema;
+    const JsonValue& document;
+
+    // Node of every pointer referred to so far
+    std::vector<std::pair<std::string, std::uint32_t>> references;
+
+    // References being resolved, outermost first: aliases (a subschema that is only a $ref) and the nodes of
+    // the subschemas being compiled
+    struct Pending {
+        std::string ref;
+        bool alias;
+        std::uint32_t node;
+    };
+    std::vector<Pending> chain;
+
+public:
+
+    Compiler(JsonSchema& schema, const JsonValue& document)
+        : schema(schema), document(document) {}
+
+    // Node for a subschema, a new one unless the subschema is a boolean or only a $ref
+    std::uint32_t compile(const JsonValue& value) {
+        if (value.isBool()) {
+            return value.getAsBool() ? anyNode : noNode;
+        }
+        if (!value.isObject()) {
+            invalidSchema("a schema must be an object or a boolean");
+        }
+
+        if (const JsonValue* ref = refOf(value)) {
+            return reference(ref->getAsStringView());
+        }
+
+        const std::uint32_t index = addNode();
+        fill(index, value);
+        return index;
+    }
+
+    // Node of the subschema a "#..." reference points to
+    std::uint32_t reference(std::string_view ref) {
+        for (const auto& known : references) {
+            if (known.first == ref) {
+                return known.second;
+            }
+        }
+
+        // An alias met again while it is resolved is the first subschema its chain of aliases reaches, which
+        // is being compiled. Without any, the aliases only lead to one another.
+        for (std::size_t i = 0; i < chain.size(); ++i) {
+            if (chain[i].ref == ref) {
+                for (std::size_t j = i + 1; j < chain.size(); ++j) {
+                    if (!chain[j].alias) {
+                        return chain[j].node;
+                    }
+                }
+                invalidSchema("$ref " + std::string(ref) + " only leads back to itself");
+            }
+        }
+
+        const JsonValue& target = resolve(ref);
+        if (target.isBool()) {
+            return target.getAsBool() ? anyNode : noNode;
+        }
+        if (!target.isObject()) {
+            invalidSchema("$ref " + std::string(ref) + " does not point to a schema");
+        }
+
+        // An alias is the node of what it refers to
+        if (const JsonValue* alias = refOf(target)) {
+            chain.push_back({std::string(ref), true, 0});
+            const std::uint32_t aliased = reference(alias->getAsStringView());
+            chain.pop_back();
+            references.emplace_back(std::string(ref), aliased);
+            return aliased;
+        }
+
+        // The node exists before its subschemas are compiled, so a subschema can refer back to it
+        const std::uint32_t index = addNode();
+        references.emplace_back(std::string(ref), index);
+        chain.push_back({std::string(ref), false, index});
+        fill(index, target);
+        chain.pop_back();
+        return index;
+    }
+
+private:
+
+    std::uint32_t addNode() {
+        if (schema.nodes.size() >= UINT32_MAX) {
+            invalidSchema("too many subschemas");
+        }
+        schema.nodes.emplace_back();
+        return std::uint32_t(schema.nodes.size() - 1);
+    }
+
+    // The $ref of a subschema that is nothing but a reference, nullptr if it has none
+    static const JsonValue* refOf(const JsonValue& value) {
+        const JsonValue::JsonObject& keywords = value.getAsObject();
+        const auto ref = keywords.find("$ref");
+        if (ref == keywords.end()) {
+            return nullptr;
+        }
+        if (!ref->second.isString()) {
+            invalidSchema("$ref must be a string");
+        }
+        for (const char* keyword : constraintKeywords) {
+            if (keywords.find(keyword) != keywords.end()) {
+                throw std::runtime_error("Unsupported JSON schema: $ref next to " + std::string(keyword));
+            }
+        }
+        return &ref->second;
+    }
+
+    // Follow a JSON pointer fragment from the root of the schema
+    const JsonValue& resolve(std::string_view ref) const {
+        if (ref.empty() || ref[0] != '#') {
+            throw std::runtime_error("Unsupported JSON schema: only references inside the schema are supported, not "
+                                     + std::string(ref));
+        }
+
+        const JsonValue* current = &document;
+        std::size_t i = 1;
+        while (i < ref.size()) {
+            if (ref[i] != '/') {
+                throw std::runtime_error("Unsupported JSON schema: $ref " + std::string(ref));
+            }
+            std::string token;
+            for (++i; i < ref.size() && ref[i] != '/'; ++i) {
+                if (ref[i] == '~' && i + 1 < ref.size() && (ref[i + 1] == '0' || ref[i + 1] == '1')) {
+                    token.push_back(ref[++i] == '0' ? '~' : '/');
+                } else {
+                    token.push_back(ref[i]);
+                }
+            }
+
+            if (current->isObject()) {
+                const auto member = current->getAsObject().find(token);
+                if (member == current->getAsObject().end()) {
+                    invalidSchema("$ref " + std::string(ref) + " does not point to anything");
+                }
+                current = &member->second;
+            } else if (current->isArray() && !token.empty() && token.find_first_not_of("0123456789") == token.npos
+                       && std::stoull(token) < current->getAsArray().size()) {
+                current = &current->getAsArray()[std::size_t(std::stoull(token))];
+            } else {
+                invalidSchema("$ref " + std::string(ref) + " does not point to anything");
+            }
+        }
+        return *current;
+    }
+
+    // Keywords of an object schema into its node. Subschemas add nodes, so the node is built apart
+    // and stored at the end
+    void fill(std::uint32_t index, const JsonValue& value) {
+        const JsonValue::JsonObject& keywords = value.getAsObject();
+        Node node;
+
+        for (const char* keyword : unsupportedKeywords) {
+            if (keywords.find(keyword) != keywords.end()) {
+                throw std::runtime_error("Unsupported JSON schema keyword: " + std::string(keyword));
+            }
+        }
+
+        if (const JsonValue* type = find(keywords, "type")) {
+            node.types = 0;
+            if (type->isArray()) {
+                for (const JsonValue& name : type->getAsArray()) {
+                    node.types |= typeOf(name);
+                }
+            } else {
+                node.types = typeOf(*type);
+            }
+        }
+
+        if (const JsonValue* values = find(keywords, "enum")) {
+            if (!values->isArray()) {
+                invalidSchema("enum must be an array");
+            }
+            node.hasEnum = true;
+            for (const JsonValue& allowed : values->getAsArray()) {
+                node.enumValues.push_back(scalar(allowed, "enum"));
+            }
+        }
+        if (const JsonValue* constant = find(keywords, "const")) {
+            JsonValue allowed = scalar(*constant, "const");
+            const bool listed = !node.hasEnum || std::any_of(node.enumValues.begin(), node.enumValues.end(),
+                [&](const JsonValue& other) { return sameScalar(allowed, other); });
+            node.hasEnum = true;
+            node.enumValues.clear();
+            if (listed) {
+                node.enumValues.push_back(std::move(allowed));
+            }
+        }
+
+        // The strictest of minimum / exclusiveMinimum, and of maximum / exclusiveMaximum
+        if (const JsonValue* minimum = find(keywords, "minimum")) {
+            numberOf(*minimum, "minimum");
+            node.hasMinimum = true;
+            node.minimum = *minimum;
+        }
+        if (const JsonValue* minimum = find(keywords, "exclusiveMinimum")) {
+            numberOf(*minimum, "exclusiveMinimum");
+            if (!node.hasMinimum || compareNumbers(*minimum, node.minimum) >= 0) {
+                node.hasMinimum = node.exclusiveMinimum = true;
+                node.minimum = *minimum;
+            }
+        }
+        if (const JsonValue* maximum = find(keywords, "maximum")) {
+            numberOf(*maximum, "maximum");
+            node.hasMaximum = true;
+            node.maximum = *maximum;
+        }
+        if (const JsonValue* maximum = find(keywords, "exclusiveMaximum")) {
+            numberOf(*maximum, "exclusiveMaximum");
+            if (!node.hasMaximum || compareNumbers(*maximum, node.maximum) <= 0) {
+                node.hasMaximum = node.exclusiveMaximum = true;
+                node.maximum = *maximum;
+            }
+        }
+        if (const JsonValue* multipleOf = find(keywords, "multipleOf")) {
+            if (!(numberOf(*multipleOf, "multipleOf") > 0)) {
+                invalidSchema("multipleOf must be greater than 0");
+            }
+            node.hasMultipleOf = true;
+            node.multipleOf = *multipleOf;
+        }
+
+        if (const JsonValue* length = find(keywords, "minLength")) {
+            node.minLength = countOf(*length, "minLength");
+        }
+        if (const JsonValue* length = find(keywords, "maxLength")) {
+            node.maxLength = countOf(*length, "maxLength");
+        }
+
+        if (const JsonValue* properties = find(keywords, "properties")) {
+            if (!properties->isObject()) {
+                invalidSchema("properties must be an object");
+            }
+            for (const auto& property : properties->getAsObject()) {
+                const std::uint32_t child = compile(property.second);
+                node.properties.push_back({std::string(property.first.view()), child, -1});
+            }
+        }
+        if (const JsonValue* required = find(keywords, "required")) {
+            if (!required->isArray()) {
+                invalidSchema("required must be an array");
+            }
+            for (const JsonValue& name : required->getAsArray()) {
+                if (!name.isString()) {
+                    invalidSchema("required must only hold strings");
+                }
+                auto property = std::find_if(node.properties.begin(), node.properties.end(),
+                    [&](const Property& p) { return p.name == name.getAsStringView(); });
+                if (property == node.properties.end()) {
+                    node.properties.push_back({std::string(name.getAsStringView()), anyNode, -1});
+                    property = std::prev(node.properties.end());
+                }
+                if (property->required < 0) {
+                    property->required = std::int32_t(node.requiredCount++);
+                }
+            }
+        }
+        if (const JsonValue* additional = find(keywords, "additionalProperties")) {
+            node.additional = compile(*additional);
+        }
+        if (const JsonValue* count = find(keywords, "minProperties")) {
+            node.minProperties = countOf(*count, "minProperties");
+        }
+        if (const JsonValue* count = find(keywords, "maxProperties")) {
+            node.maxProperties = countOf(*count, "maxProperties");
+        }
+        buildKeyTable(node);
+
+        // Before 2020-12 an array of items was what prefixItems is now, and additionalItems the rest
+        const JsonValue* prefixItems = find(keywords, "prefixItems");
+        const JsonValue* items = find(keywords, "items");
+        if (items != nullptr && items->isArray() && prefixItems == nullptr) {
+            prefixItems = items;
+            items = find(keywords, "additionalItems");
+        }
+        if (prefixItems != nullptr) {
+            if (!prefixItems->isArray()) {
+                invalidSchema("prefixItems must be an array");
+            }
+            for (const JsonValue& item : prefixItems->getAsArray()) {
+                node.prefixItems.push_back(compile(item));
+            }
+        }
+        if (items != nullptr) {
+            node.items = compile(*items);
+        }
+        if (const JsonValue* count = find(keywords, "minItems")) {
+            node.minItems = countOf(*count, "minItems");
+        }
+        if (const JsonValue* count = find(keywords, "maxItems")) {
+            node.maxItems = countOf(*count, "maxItems");
+        }
+
+        schema.nodes[index] = std::move(node);
+    }
+
+    static const JsonValue* find(const JsonValue::JsonObject& keywords, std::string_view keyword) {
+        const auto it = keywords.find(keyword);
+        return it == keywords.end() ? nullptr : &it->second;
+    }
+
+    static unsigned typeOf(const JsonValue& name) {
+        const std::string_view type = name.isString() ? name.getAsStringView() : std::string_view();
+        if (type == "null") return NullType;
+        if (type == "boolean") return BoolType;
+        if (type == "integer") return IntegerType;
+        if (type == "number") return IntegerType | NumberType;
+        if (type == "string") return StringType;
+        if (type == "array") return ArrayType;
+        if (type == "object") return ObjectType;
+        invalidSchema("unknown type " + std::string(type));
+    }
+
+    static JsonValue scalar(const JsonValue& value, const char* keyword) {
+        if (value.isArray() || value.isObject()) {
+            throw std::runtime_error("Unsupported JSON schema: " + std::string(keyword) + " of arrays or objects");
+        }
+        return value;
+    }
+
+    static bool sameScalar(const JsonValue& a, const JsonValue& b) {
+        if (a.isNumber() && b.isNumber()) {
+            return a.getAsNumber() == b.getAsNumber();
+        }
+        if (a.isString() && b.isString()) {
+            return a.getAsStringView() == b.getAsStringView();
+        }
+        if (a.isBool() && b.isBool()) {
+            return a.getAsBool() == b.getAsBool();
+        }
+        return a.isNull() && b.isNull();
+    }
+
+    // Open addressing over JsonKey::hashOf, at most half full
+    static void buildKeyTable(Node& node) {
+        if (node.properties.empty()) {
+            return;
+        }
+
+        std::size_t capacity = 4;
+        while (capacity < node.properties.size() * 2) {
+            capacity *= 2;
+        }
+        node.keyTable.assign(capacity, 0);
+
+        for (std::size_t i = 0; i < node.properties.size(); ++i) {
+            std::size_t slot = JsonKey::hashOf(node.properties[i].name) & (capacity - 1);
+            while (node.keyTable[slot] != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            node.keyTable[slot] = std::uint32_t(i + 1);
+        }
+    }
+};
+
+
+JsonSchema::JsonSchema(const JsonValue &schema) {
+    nodes.resize(2);
+    nodes[noNode].types = 0;
+
+    Compiler compiler(*this, schema);
+    root = schema.isBool() ? compiler.compile(schema) : compiler.reference("#");
+}
+
+void JsonSchema::validate(const JsonValue &value) const {
+    JsonSchemaValidator validator(*this);
+    replay(value, validator);
+}
+
+void JsonSchema::validate(std::string_view input) const {
+    JsonSchemaValidator validator(*this);
+    JsonStreamParser parser(validator);
+    parser.feed(input);
+    parser.finish();
+}
+
+bool JsonSchema::isValid(const JsonValue &value) const {
+    try {
+        validate(value);
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+bool JsonSchema::isValid(std::string_view input) const {
+    try {
+        validate(input);
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+const JsonSchema::Property* JsonSchema::findProperty(const Node &node, std::string_view key) const {
+    if (node.keyTable.empty()) {
+        return nullptr;
+    }
+
+    const std::size_t mask = node.keyTable.size() - 1;
+    for (std::size_t slot = JsonKey::hashOf(key) & mask; node.keyTable[slot] != 0; slot = (slot + 1) & mask) {
+        const Property& property = node.properties[node.keyTable[slot] - 1];
+        if (property.name == key) {
+            return &property;
+        }
+    }
+    return nullptr;
+}
+
+// -------------------------------------------------------
+
+JsonSchemaValidator::JsonSchemaValidator(const JsonSchema &schema, JsonHandler *next) : schema(schema), next(next) {}
+
+void JsonSchemaValidator::reset() {
+    depth = 0;
+}
+
+void JsonSchemaValidator::startObject() {
+    startContainer(beginValue(), true);
+    if (next) next->startObject();
+}
+
+void JsonSchemaValidator::key(std::string_view str) {
+    Frame& frame = frames[depth - 1];
+    const JsonSchema::Node& node = schema.nodes[frame.node];
+    frame.key.assign(str);
+
+    if (++frame.count > node.maxProperties) {
+        fail("more than " + std::to_string(node.maxProperties) + " properties", depth - 1);
+    }
+
+    const JsonSchema::Property* property = schema.findProperty(node, str);
+    if (property != nullptr) {
+        frame.child = property->node;
+        if (property->required >= 0) {
+            frame.seenRequired[std::size_t(property->required)] = true;
+        }
+    } else {
+        frame.child = node.additional;
+    }
+
+    // Rejected by its name, before its value is read
+    if (frame.child == JsonSchema::noNode) {
+        fail("property not allowed");
+    }
+    if (next) next->key(str);
+}
+
+void JsonSchemaValidator::endObject() {
+    const Frame& frame = frames[depth - 1];
+    const JsonSchema::Node& node = schema.nodes[frame.node];
+
+    if (frame.count < node.minProperties) {
+        fail("fewer than " + std::to_string(node.minProperties) + " properties", depth - 1);
+    }
+    for (const JsonSchema::Property& property : node.properties) {
+        if (property.required >= 0 && !frame.seenRequired[std::size_t(property.required)]) {
+            fail("missing required property " + property.name, depth - 1);
+        }
+    }
+
+    depth--;
+    if (next) next->endObject();
+}
+
+void JsonSchemaValidator::startArray() {
+    startContainer(beginValue(), false);
+    if (next) next->startArray();
+}
+
+void JsonSchemaValidator::endArray() {
+    const Frame& frame = frames[depth - 1];
+    const JsonSchema::Node& node = schema.nodes[frame.node];
+
+    if (frame.count < node.minItems) {
+        fail("fewer than " + std::to_string(node.minItems) + " items", depth - 1);
+    }
+
+    depth--;
+    if (next) next->endArray();
+}
+
+void JsonSchemaValidator::string(std::string_view str) {
+    const JsonSchema::Node& node = schema.nodes[beginValue()];
+    checkType(node, JsonSchema::StringType, "string");
+
+    if (node.minLength > 0 || node.maxLength != SIZE_MAX) {
+        const std::size_t length = codePoints(str);
+        if (length < node.minLength) {
+            fail("string shorter than " + std::to_string(node.minLength));
+        }
+        if (length > node.maxLength) {
+            fail("string longer than " + std::to_string(node.maxLength));
+        }
+    }
+    if (node.hasEnum) {
+        checkEnum(node, [&](const JsonValue& allowed) { return allowed.isString() && allowed.getAsStringView() == str; });
+    }
+    if (next) next->string(str);
+}
+
+void JsonSchemaValidator::number(JsonValue::JsonNumber num) {
+    checkNumber(schema.nodes[beginValue()], JsonValue(num));
+    if (next) next->number(num);
+}
+
+void JsonSchemaValidator::integer(JsonValue::JsonInteger num) {
+    checkNumber(schema.nodes[beginValue()], JsonValue(num));
+    if (next) next->integer(num);
+}
+
+void JsonSchemaValidator::unsignedInteger(JsonValue::JsonUnsigned num) {
+    checkNumber(schema.nodes[beginValue()], JsonValue(num));
+    if (next) next->unsignedInteger(num);
+}
+
+void JsonSchemaValidator::boolean(JsonValue::JsonBool b) {
+    const JsonSchema::Node& node = schema.nodes[beginValue()];
+    checkType(node, JsonSchema::BoolType, "boolean");
+    if (node.hasEnum) {
+        checkEnum(node, [&](const JsonValue& allowed) { return allowed.isBool() && allowed.getAsBool() == b; });
+    }
+    if (next) next->boolean(b);
+}
+
+void JsonSchemaValidator::null() {
+    const JsonSchema::Node& node = schema.nodes[beginValue()];
+    checkType(node, JsonSchema::NullType, "null");
+    if (node.hasEnum) {
+        checkEnum(node, [](const JsonValue& allowed) { return allowed.isNull(); });
+    }
+    if (next) next->null();
+}
+
+std::uint32_t JsonSchemaValidator::beginValue() {
+    if (depth == 0) {
+        return schema.root;
+    }
+
+    Frame& frame = frames[depth - 1];
+    if (frame.isObject) {
+        return frame.child;
+    }
+
+    const JsonSchema::Node& node = schema.nodes[frame.node];
+    const std::size_t index = frame.count++;
+    if (frame.count > node.maxItems) {
+        fail("more than " + std::to_string(node.maxItems) + " items");
+    }
+    return index < node.prefixItems.size() ? node.prefixItems[index] : node.items;
+}
+
+void JsonSchemaValidator::checkType(const JsonSchema::Node &node, unsigned type, const char *name) {
+    if ((node.types & type) == 0) {
+        fail(node.types == 0 ? std::string("no value allowed") : std::string("unexpected ") + name);
+    }
+}
+
+void JsonSchemaValidator::checkNumber(const JsonSchema::Node &node, const JsonValue &value) {
+    const bool integral = value.isInteger() || value.isUnsigned() || isIntegral(value.getAsNumber());
+    checkType(node, integral ? JsonSchema::IntegerType | JsonSchema::NumberType : JsonSchema::NumberType,
+              integral ? "number" : "number with a fractional part");
+
+    if (node.hasMinimum && compareNumbers(value, node.minimum) < (node.exclusiveMinimum ? 1 : 0)) {
+        fail("number below the minimum");
+    }
+    if (node.hasMaximum && compareNumbers(value, node.maximum) > (node.exclusiveMaximum ? -1 : 0)) {
+        fail("number above the maximum");
+    }
+    if (node.hasMultipleOf && !isMultiple(value, node.multipleOf)) {
+        fail("number not a multiple of " + JsonWriter::toString(node.multipleOf));
+    }
+    if (node.hasEnum) {
+        checkEnum(node, [&](const JsonValue& allowed) { return allowed.isNumber() && allowed == value; });
+    }
+}
+
+void JsonSchemaValidator::checkEnum(const JsonSchema::Node &node, const std::function<bool(const JsonValue&)> &equals) {
+    if (std::none_of(node.enumValues.begin(), node.enumValues.end(), equals)) {
+        fail("value not in the enum");
+    }
+}
+
+void JsonSchemaValidator::startContainer(std::uint32_t index, bool isObject) {
+    const JsonSchema::Node& node = schema.nodes[index];
+    if (isObject) {
+        checkType(node, JsonSchema::ObjectType, "object");
+    } else {
+        checkType(node, JsonSchema::ArrayType, "array");
+    }
+    if (node.hasEnum) {
+        fail("value not in the enum");
+    }
+
+    if (depth == frames.size()) {
+        frames.emplace_back();
+    }
+    Frame& frame = frames[depth++];
+    frame.node = index;
+    frame.isObject = isObject;
+    frame.count = 0;
+    frame.child = JsonSchema::anyNode;
+    frame.seenRequired.assign(node.requiredCount, false);
+}
+
+void JsonSchemaValidator::fail(const std::string &message, std::size_t levels) const {
+    std::string pointer;
+    for (std::size_t i = 0; i < levels; ++i) {
+        pointer.push_back('/');
+        if (!frames[i].isObject) {
+            pointer += std::to_string(frames[i].count - 1);
+            continue;
+        }
+        for (const char c : frames[i].key) {
+            pointer += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1, c);
+        }
+    }
+    throw std::runtime_error("JSON schema violation at \"" + pointer + "\": " + message);
+}
+
+void JsonSchemaValidator::fail(const std::string &message) const {
+    fail(message, depth);
+}
@@ -0,0 +1,557 @@
+#include "../include/JsonStreamParser.h"
+#include "../include/JsonParser.h"
+#include "../include/StructuralIndex.h"
+#include <fstream>
+#include <cstdint>
+#include <cerrno>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define JSON_HAVE_POSIX_READ 1
+#endif
+
+namespace {
+
+    bool isDelimiter(char c) {
+        return c == ',' || c == ':' || c == '{' || c == '}' || c == '[' || c == ']';
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+JsonStreamParser::JsonStreamParser(JsonHandler &handler) : handler(handler) {}
+
+void JsonStreamParser::feed(std::string_view chunk) {
+    feed(chunk.data(), chunk.size());
+}
+
+void JsonStreamParser::feed(const char *data, std::size_t size) {
+    const std::string_view input(data, size);
+    std::size_t i = 0;
+
+    while (i < size) {
+        switch (state) {
+            case State::String: {
+                // Copy the run of plain characters in one go
+                std::size_t end = StructuralIndex::findStringSpecial(input, i);
+                while (end < size && input[end] != '"' && input[end] != '\\') {
+                    end = StructuralIndex::findStringSpecial(input, end + 1);
+                }
+                if (end > i) {
+                    flushSurrogate();
+                    token.append(data + i, end - i);
+                }
+
+                i = end;
+                if (i < size) {
+                    if (input[i++] == '"') {
+                        flushSurrogate();
+                        emitString();
+                    } else {
+                        state = State::Escape;
+                    }
+                }
+                break;
+            }
+
+            case State::Escape:
+                escape(input[i++]);
+                break;
+
+            case State::Unicode: {
+                const int digit = hexValue(input[i++]);
+                if (digit < 0) {
+                    throw std::runtime_error("Invalid unicode escape in JSON string");
+                }
+                unicodeCode = (unicodeCode << 4) | unsigned(digit);
+                if (++unicodeDigits < 4) {
+                    break;
+                }
+
+                state = State::String;
+                if (highSurrogate != 0 && unicodeCode >= 0xDC00 && unicodeCode <= 0xDFFF) {
+                    JsonParser::appendUtf8(token, 0x10000 + ((highSurrogate - 0xD800) << 10) + (unicodeCode - 0xDC00));
+                    highSurrogate = 0;
+                    break;
+                }
+
+                flushSurrogate();
+                if (unicodeCode >= 0xD800 && unicodeCode <= 0xDBFF) {
+                    highSurrogate = unicodeCode; // Wait for the low half
+                } else {
+                    JsonParser::appendUtf8(token, unicodeCode);
+                }
+                break;
+            }
+
+            case State::Literal: {
+                const std::size_t start = i;
+                while (i < size && !isSpace(input[i]) && !isDelimiter(input[i])) {
+                    i++;
+                }
+                token.append(data + start, i - start);
+
+                // The delimiter is handled by the next state
+                if (i < size) {
+                    emitLiteral();
+                }
+                break;
+            }
+
+            default: {
+                const char c = input[i++];
+                if (isSpace(c)) {
+                    break;
+                }
+
+                switch (state) {
+                    case State::Value:
+                        startValue(c);
+                        break;
+
+                    case State::ArrayNext:
+                        if (c == ']') {
+                            endContainer(c);
+                        } else if (c != ',') {
+                            startValue(c);
+                        } else if (commaAllowed) {
+                            commaAllowed = false;
+                        } else {
+                            throw std::runtime_error("Unexpected token type");
+                        }
+                        break;
+
+                    case State::ObjectNext:
+                        if (c == '}') {
+                            endContainer(c);
+                        } else if (c == '"') {
+                            token.clear();
+                            tokenIsKey = true;
+                            state = State::String;
+                        } else if (c != ',' || !commaAllowed) {
+                            throw std::runtime_error("Expected a string key in the JSON object");
+                        } else {
+                            commaAllowed = false;
+                        }
+                        break;
+
+                    case State::Colon:
+                        if (c != ':') {
+                            throw std::runtime_error("Expected a colon after the JSON object key");
+                        }
+                        state = State::Value;
+                        break;
+
+                    default:
+                        throw std::runtime_error("Unexpected tokens after the end of the JSON input");
+                }
+                break;
+            }
+        }
+    }
+}
+
+void JsonStreamParser::finish() {
+    if (state == State::Literal) {
+        emitLiteral();
+    }
+
+    if (state == State::String || state == State::Escape || state == State::Unicode) {
+        throw std::runtime_error("Unterminated string in the JSON input");
+    }
+    if (!nesting.empty()) {
+        throw std::runtime_error(nesting.back() == '{' ? "Expected a closing brace for the JSON object"
+                                                       : "Expected a closing bracket for the JSON array");
+    }
+    if (state != State::Done) {
+        throw std::runtime_error("Unexpected end of input");
+    }
+}
+
+void JsonStreamParser::reset() {
+    state = State::Value;
+    nesting.clear();
+    commaAllowed = false;
+    token.clear();
+    tokenIsKey = false;
+    highSurrogate = 0;
+}
+
+void JsonStreamParser::parseStream(std::istream &stream, JsonHandler &handler, std::size_t chunkSize) {
+    JsonStreamParser parser(handler);
+    std::vector<char> buffer(chunkSize);
+
+    while (stream.read(buffer.data(), std::streamsize(buffer.size())) || stream.gcount() > 0) {
+        parser.feed(buffer.data(), std::size_t(stream.gcount()));
+    }
+    if (stream.bad()) {
+        throw std::runtime_error("Unable to read the input stream");
+    }
+
+    parser.finish();
+}
+
+void JsonStreamParser::parseFile(const std::string &filename, JsonHandler &handler, std::size_t chunkSize) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()){
+        throw std::runtime_error("Unable to open file");
+    }
+
+    parseStream(file, handler, chunkSize);
+}
+
+void JsonStreamParser::parseDescriptor(int fd, JsonHandler &handler, std::size_t chunkSize) {
+#ifdef JSON_HAVE_POSIX_READ
+    JsonStreamParser parser(handler);
+    std::vector<char> buffer(chunkSize);
+
+    for (;;) {
+        // read returns what is available, possibly less than a chunk, and 0 at the end of the input
+        const ssize_t count = ::read(fd, buffer.data(), buffer.size());
+        if (count > 0) {
+            parser.feed(buffer.data(), std::size_t(count));
+        } else if (count == 0) {
+            break;
+        } else if (errno != EINTR) {
+            throw std::runtime_error("Unable to read the input descriptor");
+        }
+    }
+
+    parser.finish();
+#else
+    (void)fd;
+    (void)handler;
+    (void)chunkSize;
+    throw std::runtime_error("Reading a file descriptor is not supported on this system");
+#endif
+}
+
+void JsonStreamParser::startValue(char c) {
+    switch (c) {
+        case '{':
+            nesting.push_back('{');
+            commaAllowed = false;
+            state = State::ObjectNext;
+            handler.startObject();
+            break;
+
+        case '[':
+            nesting.push_back('[');
+            commaAllowed = false;
+            state = State::ArrayNext;
+            handler.startArray();
+            break;
+
+        case '"':
+            token.clear();
+            tokenIsKey = false;
+            state = State::String;
+            break;
+
+        case '}':
+        case ']':
+        case ',':
+        case ':':
+            throw std::runtime_error("Unexpected token type");
+
+        default:
+            token.clear();
+            token.push_back(c);
+            state = State::Literal;
+            break;
+    }
+}
+
+void JsonStreamParser::afterValue() {
+    if (nesting.empty()) {
+        state = State::Done;
+    } else {
+        state = nesting.back() == '[' ? State::ArrayNext : State::ObjectNext;
+        commaAllowed = true;
+    }
+}
+
+void JsonStreamParser::endContainer(char close) {
+    nesting.pop_back();
+    if (close == '}') {
+        handler.endObject();
+    } else {
+        handler.endArray();
+    }
+    afterValue();
+}
+
+void JsonStreamParser::emitLiteral() {
+    const JsonValue value = JsonParser::parseLiteral(token);
+
+    if (value.isInteger()) {
+        handler.integer(value.getAsInteger());
+    } else if (value.isUnsigned()) {
+        handler.unsignedInteger(value.getAsUnsigned());
+    } else if (value.isNumber()) {
+        handler.number(value.getAsNumber());
+    } else if (value.isBool()) {
+        handler.boolean(value.getAsBool());
+    } else {
+        handler.null();
+    }
+    afterValue();
+}
+
+void JsonStreamParser::emitString() {
+    if (tokenIsKey) {
+        handler.key(token);
+        state = State::Colon;
+    } else {
+        handler.string(token);
+        afterValue();
+    }
+}
+
+void JsonStreamParser::flushSurrogate() {
+    if (highSurrogate != 0) {
+        JsonParser::appendUtf8(token, highSurrogate);
+        highSurrogate = 0;
+    }
+}
+
+void JsonStreamParser::escape(char c) {
+    if (c == 'u') {
+        unicodeCode = 0;
+        unicodeDigits = 0;
+        state = State::Unicode;
+        return;
+    }
+
+    flushSurrogate();
+    switch (c) {
+        case 'b': token.push_back('\b'); break;
+        case 'f': token.push_back('\f'); break;
+        case 'n': token.push_back('\n'); break;
+        case 'r': token.push_back('\r'); break;
+        case 't': token.push_back('\t'); break;
+        default: token.push_back(c); break; // \\ \" \/ and unknown escapes
+    }
+    state = State::String;
+}
+
+// -------------------------------------------------------
+
+JsonValueBuilder::JsonValueBuilder(std::pmr::memory_resource *resource) : builder(resource) {}
+
+void JsonValueBuilder::startObject() {
+    builder.beginObject();
+}
+
+void JsonValueBuilder::key(std::string_view str) {
+    builder.key(str);
+}
+
+void JsonValueBuilder::endObject() {
+    builder.endObject();
+}
+
+void JsonValueBuilder::startArray() {
+    builder.beginArray();
+}
+
+void JsonValueBuilder::endArray() {
+    builder.endArray();
+}
+
+void JsonValueBuilder::string(std::string_view str) {
+    builder.value(str);
+}
+
+void JsonValueBuilder::number(JsonValue::JsonNumber num) {
+    builder.value(num);
+}
+
+void JsonValueBuilder::integer(JsonValue::JsonInteger num) {
+    builder.value(num);
+}
+
+void JsonValueBuilder::unsignedInteger(JsonValue::JsonUnsigned num) {
+    builder.value(num);
+}
+
+void JsonValueBuilder::boolean(JsonValue::JsonBool b) {
+    builder.value(b);
+}
+
+void JsonValueBuilder::null() {
+    builder.value(JsonValue::JsonNull{});
+}
+
+bool JsonValueBuilder::hasResult() const {
+    return builder.hasResult();
+}
+
+JsonValue JsonValueBuilder::takeResult() {
+    return builder.takeResult();
+}
+
+// -------------------------------------------------------
+
+JsonSubtreeCollector::JsonSubtreeCollector(Selector select, Receiver receive)
+    : select(std::move(select)), receive(std::move(receive)) {}
+
+bool JsonSubtreeCollector::beginValue() {
+    if (!nextIndex.empty() && nextIndex.back() != SIZE_MAX) {
+        path.back() = nextIndex.back()++;
+    }
+    return select(path);
+}
+
+void JsonSubtreeCollector::endCapture() {
+    receive(path, builder.takeResult());
+}
+
+void JsonSubtreeCollector::startObject() {
+    if (captureDepth > 0 || beginValue()) {
+        captureDepth++;
+        builder.startObject();
+        return;
+    }
+
+    path.emplace_back(std::string());
+    nextIndex.push_back(SIZE_MAX);
+}
+
+void JsonSubtreeCollector::key(std::string_view str) {
+    if (captureDepth > 0) {
+        builder.key(str);
+        return;
+    }
+
+    path.back() = std::string(str);
+}
+
+void JsonSubtreeCollector::endObject() {
+    if (captureDepth > 0) {
+        builder.endObject();
+        if (--captureDepth == 0) {
+            endCapture();
+        }
+        return;
+    }
+
+    path.pop_back();
+    nextIndex.pop_back();
+}
+
+void JsonSubtreeCollector::startArray() {
+    if (captureDepth > 0 || beginValue()) {
+        captureDepth++;
+        builder.startArray();
+        return;
+    }
+
+    path.emplace_back(std::size_t(0));
+    nextIndex.push_back(0);
+}
+
+void JsonSubtreeCollector::endArray() {
+    if (captureDepth > 0) {
+        builder.endArray();
+        if (--captureDepth == 0) {
+            endCapture();
+        }
+        return;
+    }
+
+    path.pop_back();
+    nextIndex.pop_back();
+}
+
+void JsonSubtreeCollector::string(std::string_view str) {
+    if (captureDepth > 0) {
+        builder.string(str);
+    } else if (beginValue()) {
+        builder.string(str);
+        endCapture();
+    }
+}
+
+void JsonSubtreeCollector::number(JsonValue::JsonNumber num) {
+    if (captureDepth > 0) {
+        builder.number(num);
+    } else if (beginValue()) {
+        builder.number(num);
+        endCapture();
+    }
+}
+
+void JsonSubtreeCollector::integer(JsonValue::JsonInteger num) {
+    if (captureDepth > 0) {
+        builder.integer(num);
+    } else if (beginValue()) {
+        builder.integer(num);
+        endCapture();
+    }
+}
+
+void JsonSubtreeCollector::unsignedInteger(JsonValue::JsonUnsigned num) {
+    if (captureDepth > 0) {
+        builder.unsignedInteger(num);
+    } else if (beginValue()) {
+        builder.unsignedInteger(num);
+        endCapture();
+    }
+}
+
+void JsonSubtreeCollector::boolean(JsonValue::JsonBool b) {
+    if (captureDepth > 0) {
+        builder.boolean(b);
+    } else if (beginValue()) {
+        builder.boolean(b);
+        endCapture();
+    }
+}
+
+void JsonSubtreeCollector::null() {
+    if (captureDepth > 0) {
+        builder.null();
+    } else if (beginValue()) {
+        builder.null();
+        endCapture();
+    }
+}
+
+
+
+JsonIncrementalParser::JsonIncrementalParser() : parser(builder) {}
+
+void JsonIncrementalParser::feed(const char *data, std::size_t size) {
+    parser.feed(data, size);
+}
+
+void JsonIncrementalParser::feed(std::string_view chunk) {
+    parser.feed(chunk.data(), chunk.size());
+}
+
+JsonValue JsonIncrementalParser::finish() {
+    parser.finish();
+    parser.reset();
+    return builder.takeResult();
+}
+
+void JsonIncrementalParser::reset() {
+    parser.reset();
+    builder = JsonValueBuilder();
+}
+
+JsonValue JsonIncrementalParser::readDescriptor(int fd, std::size_t chunkSize) {
+    JsonValueBuilder builder;
+    JsonStreamParser::parseDescriptor(fd, builder, chunkSize);
+    return builder.takeResult();
+}
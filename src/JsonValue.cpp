@@ -1,34 +1,338 @@
 #include "../include/JsonValue.h"
+#include "../include/JsonWriter.h"
+#include "../include/JsonDocument.h"
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(void*) != 8 || sizeof(JsonValue) == 16, "JsonValue is expected to be a 16 byte node");
+
+template <typename T>
+struct JsonValue::Stored {
+    T value;
+    mutable std::uint64_t hash = 0; // 0 until computed
+
+    template <typename... Args>
+    explicit Stored(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+    allocator_type get_allocator() const { return value.get_allocator(); }
+};
+
+namespace {
+
+    // Out of line storage is allocated from the resource it is built with and remembers it,
+    // through its own allocator, so it can be given back to the same resource.
+    template <typename T, typename... Args>
+    T* createIn(std::pmr::memory_resource* resource, Args&&... args) {
+        void* memory = resource->allocate(sizeof(T), alignof(T));
+        try {
+            return new (memory) T(std::forward<Args>(args)..., JsonValue::allocator_type(resource));
+        } catch (...) {
+            resource->deallocate(memory, sizeof(T), alignof(T));
+            throw;
+        }
+    }
+
+    template <typename T>
+    void destroyIn(T* storage) {
+        std::pmr::memory_resource* resource = storage->get_allocator().resource();
+        storage->~T();
+        resource->deallocate(storage, sizeof(T), alignof(T));
+    }
+
+    // Finalizer of splitmix64, every input bit affects every output bit
+    std::uint64_t mix(std::uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Distinct seeds per kind of value, so e.g. [] and {} or 0 and false do not collide
+    enum Seed : std::uint64_t {
+        NullSeed = 0x6E756C6C,
+        BoolSeed = 0x626F6F6C,
+        NumberSeed = 0x6E756D62,
+        DoubleSeed = 0x646F7562,
+        StringSeed = 0x73747269,
+        ArraySeed = 0x61727261,
+        ObjectSeed = 0x6F626A65
+    };
+
+    constexpr double twoTo63 = 9223372036854775808.0;
+    constexpr double twoTo64 = 18446744073709551616.0;
+
+    // Numbers of equal value hash the same whatever their representation: integral ones as integers
+    std::uint64_t numberHash(const JsonValue& value) {
+        if (value.isInteger()) {
+            return mix(std::uint64_t(value.getAsInteger()) ^ NumberSeed);
+        }
+        if (value.isUnsigned()) {
+            return mix(value.getAsUnsigned() ^ NumberSeed);
+        }
+
+        const double num = value.getAsNumber();
+        if (num >= -twoTo63 && num < twoTo63 && num == double(std::int64_t(num))) {
+            return mix(std::uint64_t(std::int64_t(num)) ^ NumberSeed);
+        }
+        if (num >= twoTo63 && num < twoTo64 && num == double(std::uint64_t(num))) {
+            return mix(std::uint64_t(num) ^ NumberSeed);
+        }
+
+        std::uint64_t bits;
+        std::memcpy(&bits, &num, sizeof(bits));
+        return mix(bits ^ DoubleSeed);
+    }
+
+    // Exact comparison, an integer and a double are equal only when the double holds that very integer
+    bool sameNumber(const JsonValue& a, const JsonValue& b) {
+        const bool aExact = a.isInteger() || a.isUnsigned();
+        const bool bExact = b.isInteger() || b.isUnsigned();
+
+        if (aExact && bExact) {
+            if (a.isUnsigned() != b.isUnsigned()) {
+                const JsonValue& signedValue = a.isUnsigned() ? b : a;
+                const JsonValue& unsignedValue = a.isUnsigned() ? a : b;
+                return signedValue.getAsInteger() >= 0
+                    && JsonValue::JsonUnsigned(signedValue.getAsInteger()) == unsignedValue.getAsUnsigned();
+            }
+            return a.isUnsigned() ? a.getAsUnsigned() == b.getAsUnsigned() : a.getAsInteger() == b.getAsInteger();
+        }
+        if (!aExact && !bExact) {
+            return a.getAsNumber() == b.getAsNumber();
+        }
+
+        const JsonValue& exact = aExact ? a : b;
+        const double num = aExact ? b.getAsNumber() : a.getAsNumber();
+        if (exact.isInteger()) {
+            return num >= -twoTo63 && num < twoTo63 && num == double(std::int64_t(num))
+                && std::int64_t(num) == exact.getAsInteger();
+        }
+        return num >= 0 && num < twoTo64 && num == double(std::uint64_t(num))
+            && std::uint64_t(num) == exact.getAsUnsigned();
+    }
+}
+
+JsonValue::JsonValue(const JsonObject &obj) : type(Type::Object) {
+    payload.object = createIn<Stored<JsonObject>>(std::pmr::get_default_resource(), obj);
+}
+
+JsonValue::JsonValue(const JsonArray &arr) : type(Type::Array) {
+    payload.array = createIn<Stored<JsonArray>>(std::pmr::get_default_resource(), arr);
+}
+
+JsonValue::JsonValue(const JsonString &str) : type(Type::String) {
+    payload.string = createIn<JsonString>(std::pmr::get_default_resource(), str);
+}
+
+JsonValue::JsonValue(JsonObject &&obj) : type(Type::Object) {
+    payload.object = createIn<Stored<JsonObject>>(obj.get_allocator().resource(), std::move(obj));
+}
+
+JsonValue::JsonValue(JsonArray &&arr) : type(Type::Array) {
+    payload.array = createIn<Stored<JsonArray>>(arr.get_allocator().resource(), std::move(arr));
+}
+
+JsonValue::JsonValue(JsonString &&str) : type(Type::String) {
+    payload.string = createIn<JsonString>(str.get_allocator().resource(), std::move(str));
+}
+
+JsonValue JsonValue::borrowed(std::string_view str) {
+    if (str.size() > UINT32_MAX) {
+        return JsonValue(JsonString(str));
+    }
+
+    JsonValue value;
+    value.payload.borrowed = str.data();
+    value.borrowedSize = std::uint32_t(str.size());
+    value.type = Type::Borrowed;
+    return value;
+}
+
+JsonValue::JsonValue(const JsonValue &other, const allocator_type &alloc) : JsonValue() {
+    copyFrom(other, alloc.resource());
+}
+
+JsonValue::JsonValue(JsonValue &&other, const allocator_type &alloc) : JsonValue() {
+    std::pmr::memory_resource* resource = alloc.resource();
+
+    switch (other.type) {
+        case Type::String:
+            if (*other.payload.string->get_allocator().resource() != *resource) {
+                payload.string = createIn<JsonString>(resource, std::move(*other.payload.string));
+                type = Type::String;
+                return;
+            }
+            break;
+        case Type::Borrowed: {
+            // The characters are only known to outlive the values of the document arena holding them
+            const JsonArena* arena = dynamic_cast<const JsonArena*>(resource);
+            if (arena == nullptr || !arena->holds(other.payload.borrowed)) {
+                payload.string = createIn<JsonString>(resource, other.payload.borrowed, std::size_t(other.borrowedSize));
+                type = Type::String;
+                return;
+            }
+            break;
+        }
+        case Type::Array:
+            if (*other.payload.array->get_allocator().resource() != *resource) {
+                payload.array = createIn<Stored<JsonArray>>(resource, std::move(other.payload.array->value));
+                payload.array->hash = other.payload.array->hash;
+                type = Type::Array;
+                return;
+            }
+            break;
+        case Type::Object:
+            if (*other.payload.object->get_allocator().resource() != *resource) {
+                payload.object = createIn<Stored<JsonObject>>(resource, std::move(other.payload.object->value));
+                payload.object->hash = other.payload.object->hash;
+                type = Type::Object;
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Scalars, borrowed strings of the arena, or storage already in the right resource: take it over
+    payload = other.payload;
+    type = other.type;
+    borrowedSize = other.borrowedSize;
+    other.type = Type::Null;
+}
+
+JsonValue::JsonValue(const JsonValue &other) : JsonValue() {
+    copyFrom(other, std::pmr::get_default_resource());
+}
+
+JsonValue::JsonValue(JsonValue &&other) noexcept
+    : payload(other.payload), type(other.type), borrowedSize(other.borrowedSize) {
+    other.type = Type::Null;
+}
+
+JsonValue& JsonValue::operator=(const JsonValue &other) {
+    if (this != &other) {
+        *this = JsonValue(other);
+    }
+    return *this;
+}
+
+JsonValue& JsonValue::operator=(JsonValue &&other) noexcept {
+    if (this != &other) {
+        // other may live inside this value, e.g. v = std::move(v["a"]), so it is taken before release
+        const Payload taken = other.payload;
+        const Type takenType = other.type;
+        const std::uint32_t takenSize = other.borrowedSize;
+        other.type = Type::Null;
+        release();
+        payload = taken;
+        type = takenType;
+        borrowedSize = takenSize;
+    }
+    return *this;
+}
+
+JsonValue::~JsonValue() {
+    release();
+}
+
+JsonValue::allocator_type JsonValue::getAllocator() const {
+    switch (type) {
+        case Type::String: return payload.string->get_allocator();
+        case Type::Array: return payload.array->get_allocator();
+        case Type::Object: return payload.object->get_allocator();
+        default: return {};
+    }
+}
+
+void JsonValue::copyFrom(const JsonValue &other, std::pmr::memory_resource *resource) {
+    switch (other.type) {
+        case Type::String:
+            payload.string = createIn<JsonString>(resource, *other.payload.string);
+            break;
+        case Type::Borrowed:
+            payload.string = createIn<JsonString>(resource, other.payload.borrowed, std::size_t(other.borrowedSize));
+            type = Type::String;
+            return;
+        case Type::Array:
+            payload.array = createIn<Stored<JsonArray>>(resource, other.payload.array->value);
+            payload.array->hash = other.payload.array->hash;
+            break;
+        case Type::Object:
+            payload.object = createIn<Stored<JsonObject>>(resource, other.payload.object->value);
+            payload.object->hash = other.payload.object->hash;
+            break;
+        default:
+            payload = other.payload;
+            break;
+    }
+    type = other.type;
+}
 
+void JsonValue::ownString() const {
+    if (type == Type::Borrowed) {
+        // A document does not free the values of its tree, the string has to be in its arena too
+        std::pmr::memory_resource* resource = JsonArena::holding(payload.borrowed);
+        if (resource == nullptr) {
+            resource = std::pmr::get_default_resource();
+        }
+        payload.string = createIn<JsonString>(resource, payload.borrowed, std::size_t(borrowedSize));
+        type = Type::String;
+    }
+}
 
+void JsonValue::abandon() {
+    type = Type::Null;
+}
+
+void JsonValue::release() {
+    switch (type) {
+        case Type::String:
+            destroyIn(payload.string);
+            break;
+        case Type::Array:
+            destroyIn(payload.array);
+            break;
+        case Type::Object:
+            destroyIn(payload.object);
+            break;
+        default:
+            break;
+    }
+    type = Type::Null;
+}
 
 bool JsonValue::isBool() const {
-    return std::holds_alternative<JsonBool>(value);
+    return type == Type::Bool;
 }
 bool JsonValue::isNumber() const {
-    return std::holds_alternative<JsonNumber>(value);
+    return type == Type::Number || type == Type::Integer || type == Type::Unsigned;
+}
+bool JsonValue::isInteger() const {
+    return type == Type::Integer;
+}
+bool JsonValue::isUnsigned() const {
+    return type == Type::Unsigned;
 }
 bool JsonValue::isString()  const {
-    return std::holds_alternative<JsonString>(value);
+    return type == Type::String || type == Type::Borrowed;
 }
 
 bool JsonValue::isArray() const {
-    return std::holds_alternative<JsonArray>(value);
+    return type == Type::Array;
 }
 
 bool JsonValue::isObject() const {
-    return std::holds_alternative<JsonObject>(value);
+    return type == Type::Object;
 }
 
 bool JsonValue::isNull() const {
-    return std::holds_alternative<JsonNull>(value);
+    return type == Type::Null;
 }
 
 
 
 const JsonValue::JsonObject& JsonValue::getAsObject() const {
     if (isObject()){
-        return std::get<JsonObject>(value);
+        return payload.object->value;
     }
 
     else{
@@ -38,7 +342,7 @@ const JsonValue::JsonObject& JsonValue::getAsObject() const {
 
 const JsonValue::JsonArray& JsonValue::getAsArray() const {
     if (isArray()){
-        return std::get<JsonArray>(value);
+        return payload.array->value;
     }
 
     else{
@@ -48,7 +352,22 @@ const JsonValue::JsonArray& JsonValue::getAsArray() const {
 
 const JsonValue::JsonString& JsonValue::getAsString() const {
     if (isString()){
-        return std::get<JsonString>(value);
+        ownString();
+        return *payload.string;
+    }
+
+    else{
+        throw std::runtime_error("Bad Access, not a string");
+    }
+}
+
+std::string_view JsonValue::getAsStringView() const {
+    if (type == Type::Borrowed){
+        return std::string_view(payload.borrowed, borrowedSize);
+    }
+
+    else if (type == Type::String){
+        return *payload.string;
     }
 
     else{
@@ -57,18 +376,45 @@ const JsonValue::JsonString& JsonValue::getAsString() const {
 }
 
 JsonValue::JsonNumber JsonValue::getAsNumber() const {
-    if (isNumber()){
-        return std::get<JsonNumber>(value);
+    switch (type) {
+        case Type::Number: return payload.number;
+        case Type::Integer: return JsonNumber(payload.integer);
+        case Type::Unsigned: return JsonNumber(payload.unsignedInteger);
+        default: throw std::runtime_error("Bad Access, not a number");
+    }
+}
+
+JsonValue::JsonInteger JsonValue::getAsInteger() const {
+    if (isInteger()){
+        return payload.integer;
+    }
+
+    else if (isUnsigned() && payload.unsignedInteger <= JsonUnsigned(INT64_MAX)){
+        return JsonInteger(payload.unsignedInteger);
     }
 
     else{
-        throw std::runtime_error("Bad Access, not a number");
+        throw std::runtime_error("Bad Access, not an integer in range");
+    }
+}
+
+JsonValue::JsonUnsigned JsonValue::getAsUnsigned() const {
+    if (isUnsigned()){
+        return payload.unsignedInteger;
+    }
+
+    else if (isInteger() && payload.integer >= 0){
+        return JsonUnsigned(payload.integer);
+    }
+
+    else{
+        throw std::runtime_error("Bad Access, not an unsigned integer");
     }
 }
 
 JsonValue::JsonBool JsonValue::getAsBool() const {
     if (isBool()){
-        return std::get<JsonBool>(value);
+        return payload.boolean;
     }
 
     else{
@@ -81,7 +427,9 @@ JsonValue::JsonObject& JsonValue::getAsObject() {
         throw std::runtime_error("Bad Access, not an object");
     }
 
-    return std::get<JsonObject>(value);
+    // The caller may change the members
+    payload.object->hash = 0;
+    return payload.object->value;
 }
 
 JsonValue::JsonArray& JsonValue::getAsArray() {
@@ -89,7 +437,8 @@ JsonValue::JsonArray& JsonValue::getAsArray() {
         throw std::runtime_error("Bad Access, not an array");
     }
 
-    return std::get<JsonArray>(value);
+    payload.array->hash = 0;
+    return payload.array->value;
 }
 
 JsonValue::JsonString& JsonValue::getAsString() {
@@ -97,15 +446,16 @@ JsonValue::JsonString& JsonValue::getAsString() {
         throw std::runtime_error("Bad Access, not a string");
     }
 
-    return std::get<JsonString>(value);
+    ownString();
+    return *payload.string;
 }
 
-JsonValue& JsonValue::operator[](const JsonString& str) {
+JsonValue& JsonValue::operator[](std::string_view str) {
     if (!isObject()){
         throw std::runtime_error("JsonValue is not an Object");
     }
 
-    return std::get<JsonObject>(value)[str];
+    return getAsObject()[str];
 }
 
 JsonValue& JsonValue::operator[](std::size_t idx) {
@@ -113,10 +463,10 @@ JsonValue& JsonValue::operator[](std::size_t idx) {
         throw std::runtime_error("JsonValue is not an Array");
     }
 
-    return std::get<JsonArray>(value)[idx];
+    return getAsArray()[idx];
 }
 
-const JsonValue& JsonValue::operator[](const JsonString & str) const {
+const JsonValue& JsonValue::operator[](std::string_view str) const {
     if (!isObject()){
         throw std::runtime_error("JsonValue is not an Object");
     }
@@ -148,53 +498,137 @@ const JsonValue& JsonValue::operator[](std::size_t idx) const{
 }
 
 void JsonValue::readablePrint(std::ostream &os, int indent) const {
-    {
-        const std::string indentStr(indent * 2, ' ');
-
-        if (isObject()) {
-            const JsonObject& obj = getAsObject();
-            os << "{\n";
-            for (auto it = obj.begin(); it != obj.end(); ++it) {
-                os << indentStr << "  \"" << it->first << "\": ";
-                it->second.readablePrint(os, indent + 1);
-                if (std::next(it) != obj.end()) {
-                    os << ",";
-                }
-                os << "\n";
-            }
-            os << indentStr << "}";
-        } else if (isArray()) {
+    JsonWriter writer(JsonWriter::Style::Pretty);
+    writer.write(*this, indent);
+    writer.flush(os);
+}
 
-            const JsonArray& arr = getAsArray();
-            os << "[\n";
+bool JsonValue::operator==(const JsonValue &other) const {
+    if (this == &other) {
+        return true;
+    }
+
+    if (isNumber() && other.isNumber()) {
+        return sameNumber(*this, other);
+    }
+    if (isString() && other.isString()) {
+        return getAsStringView() == other.getAsStringView();
+    }
+    if (type != other.type) {
+        return false;
+    }
 
-            for (auto it = arr.begin(); it != arr.end(); ++it) {
-                os << indentStr << "  ";
-                it->readablePrint(os, indent + 1);
-                if (std::next(it) != arr.end()) {
-                    os << ",";
+    switch (type) {
+        case Type::Null:
+            return true;
+
+        case Type::Bool:
+            return payload.boolean == other.payload.boolean;
+
+        case Type::Array: {
+            const Stored<JsonArray>& left = *payload.array;
+            const Stored<JsonArray>& right = *other.payload.array;
+            if (left.hash != 0 && right.hash != 0 && left.hash != right.hash) {
+                return false;
+            }
+            return left.value.size() == right.value.size()
+                && std::equal(left.value.begin(), left.value.end(), right.value.begin());
+        }
+
+        case Type::Object: {
+            const Stored<JsonObject>& left = *payload.object;
+            const Stored<JsonObject>& right = *other.payload.object;
+            if (left.hash != 0 && right.hash != 0 && left.hash != right.hash) {
+                return false;
+            }
+            if (left.value.size() != right.value.size()) {
+                return false;
+            }
+            for (const auto& member : left.value) {
+                const auto it = right.value.find(member.first, member.first.hash());
+                if (it == right.value.end() || member.second != it->second) {
+                    return false;
                 }
-                os << "\n";
             }
-            os << indentStr << "]";
-        } else if (isString()) {
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool JsonValue::operator!=(const JsonValue &other) const {
+    return !(*this == other);
+}
+
+std::uint64_t JsonValue::hash() const {
+    switch (type) {
+        case Type::Null:
+            return mix(NullSeed);
+
+        case Type::Bool:
+            return mix(BoolSeed + payload.boolean);
 
-            os << "\"" << getAsString()<< "\"";
-        } else if (isNumber()) {
-            os << getAsNumber();
+        case Type::Number:
+        case Type::Integer:
+        case Type::Unsigned:
+            return numberHash(*this);
 
-        } else if (isBool()) {
-            os << (getAsBool() ? "true" : "false");
+        case Type::String:
+        case Type::Borrowed:
+            return mix(std::hash<std::string_view>{}(getAsStringView()) ^ StringSeed);
+
+        case Type::Array: {
+            if (payload.array->hash != 0) {
+                return payload.array->hash;
+            }
 
-        } else if (isNull()) {
-            os << "null";
+            // In order: each element is folded into the hash of the ones before it
+            std::uint64_t h = ArraySeed;
+            for (const JsonValue& element : payload.array->value) {
+                h = mix(h + element.hash());
+            }
+            payload.array->hash = h != 0 ? h : 1;
+            return payload.array->hash;
         }
-        else{
-            os << "Nothing to print";
+
+        default: {
+            if (payload.object->hash != 0) {
+                return payload.object->hash;
+            }
+
+            // Whatever the order: the hashes of the members are added up
+            std::uint64_t h = 0;
+            for (const auto& member : payload.object->value) {
+                h += mix(std::uint64_t(member.first.hash()) * 0x9E3779B97F4A7C15ULL + member.second.hash());
+            }
+            h = mix(h ^ ObjectSeed);
+            payload.object->hash = h != 0 ? h : 1;
+            return payload.object->hash;
         }
     }
 }
 
+std::uint64_t JsonValue::cachedHash() const {
+    switch (type) {
+        case Type::Array:
+            return payload.array->hash;
+        case Type::Object:
+            return payload.object->hash;
+        default:
+            return hash();
+    }
+}
+
+void JsonValue::clearCachedHash() const {
+    if (isArray()) {
+        payload.array->hash = 0;
+    } else if (isObject()) {
+        payload.object->hash = 0;
+    }
+}
+
 // -------------------------------------------------------
 
 void JsonValue::modifyJson(const pathInJson & path, JsonValue&& newValue, bool isArray = false) {
@@ -240,7 +674,7 @@ void JsonValue::modifyJson(const pathInJson & path, JsonValue&& newValue, bool i
 
     if (isArray){
         if (temp->isArray()){
-            *current = std::move(newValue);
+            *current = JsonValue(std::move(newValue), temp->getAllocator());
         }
         else{
             throw std::runtime_error("Expected Array but got different type");
@@ -249,7 +683,7 @@ void JsonValue::modifyJson(const pathInJson & path, JsonValue&& newValue, bool i
 
     else{
         if (temp->isObject()){
-            *current = std::move(newValue);
+            *current = JsonValue(std::move(newValue), temp->getAllocator());
         }
     }
 }
@@ -294,7 +728,7 @@ void JsonValue::addToObject(const pathInJson &path, const std::string& newKey, J
         throw std::runtime_error("Path does not lead to an object");
     }
 
-    (*current)[newKey] = std::move(newValue);
+    (*current)[newKey] = JsonValue(std::move(newValue), current->getAllocator());
 }
 
 
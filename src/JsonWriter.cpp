@@ -0,0 +1,125 @@
+#include "../include/JsonWriter.h"
+#include "../include/StructuralIndex.h"
+#include <charconv>
+#include <cmath>
+
+void JsonWriter::write(const JsonValue &value, int indent) {
+    writeValue(value, indent);
+}
+
+void JsonWriter::flush(std::ostream &os) {
+    os.write(buffer.data(), std::streamsize(buffer.size()));
+    buffer.clear();
+}
+
+std::string JsonWriter::toString(const JsonValue &value, Style style) {
+    JsonWriter writer(style);
+    writer.write(value);
+    return std::move(writer.buffer);
+}
+
+void JsonWriter::writeValue(const JsonValue &value, int indent) {
+    const bool pretty = style == Style::Pretty;
+
+    if (value.isObject()) {
+        const JsonValue::JsonObject& obj = value.getAsObject();
+        buffer.push_back('{');
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            if (it != obj.begin()) {
+                buffer.push_back(',');
+            }
+            newLine(indent + 1);
+            writeString(it->first);
+            buffer.append(pretty ? ": " : ":");
+            writeValue(it->second, indent + 1);
+        }
+        newLine(indent);
+        buffer.push_back('}');
+
+    } else if (value.isArray()) {
+        const JsonValue::JsonArray& arr = value.getAsArray();
+        buffer.push_back('[');
+        for (auto it = arr.begin(); it != arr.end(); ++it) {
+            if (it != arr.begin()) {
+                buffer.push_back(',');
+            }
+            newLine(indent + 1);
+            writeValue(*it, indent + 1);
+        }
+        newLine(indent);
+        buffer.push_back(']');
+
+    } else if (value.isString()) {
+        writeString(value.getAsStringView());
+
+    } else if (value.isInteger() || value.isUnsigned()) {
+        char digits[24];
+        const auto result = value.isInteger() ? std::to_chars(digits, digits + sizeof(digits), value.getAsInteger())
+                                              : std::to_chars(digits, digits + sizeof(digits), value.getAsUnsigned());
+        buffer.append(digits, result.ptr);
+
+    } else if (value.isNumber()) {
+        writeNumber(value.getAsNumber());
+
+    } else if (value.isBool()) {
+        buffer.append(value.getAsBool() ? "true" : "false");
+
+    } else {
+        buffer.append("null");
+    }
+}
+
+void JsonWriter::writeString(std::string_view str) {
+    static const char hexDigits[] = "0123456789abcdef";
+
+    buffer.push_back('"');
+
+    std::size_t index = 0;
+    while (index < str.size()) {
+        // Copy the run of characters that need no escaping in one go
+        const std::size_t special = StructuralIndex::findStringSpecial(str, index);
+        buffer.append(str.data() + index, special - index);
+        if (special == str.size()) {
+            break;
+        }
+
+        const char c = str[special];
+        switch (c) {
+            case '"': buffer.append("\\\""); break;
+            case '\\': buffer.append("\\\\"); break;
+            case '\b': buffer.append("\\b"); break;
+            case '\f': buffer.append("\\f"); break;
+            case '\n': buffer.append("\\n"); break;
+            case '\r': buffer.append("\\r"); break;
+            case '\t': buffer.append("\\t"); break;
+            default: {
+                const char escaped[] = {'\\', 'u', '0', '0', hexDigits[(c >> 4) & 0xF], hexDigits[c & 0xF]};
+                buffer.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+        index = special + 1;
+    }
+
+    buffer.push_back('"');
+}
+
+void JsonWriter::writeNumber(JsonValue::JsonNumber num) {
+    // JSON has no representation for infinities and NaN
+    if (!std::isfinite(num)) {
+        buffer.append("null");
+        return;
+    }
+
+    // Shortest representation that reads back to the same double
+    char digits[32];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), num);
+    buffer.append(digits, result.ptr);
+}
+
+void JsonWriter::newLine(int indent) {
+    if (style == Style::Pretty) {
+        buffer.push_back('\n');
+        buffer.append(std::size_t(indent) * 2, ' ');
+    }
+}
@@ -0,0 +1,230 @@
+#include "../include/LazyDocument.h"
+#include "../include/JsonParser.h"
+#include "../include/StructuralIndex.h"
+
+
+LazyDocument::LazyDocument(MappedFile &&mapped) : file(std::move(mapped)) {
+    positions = StructuralIndex::build(file.view());
+
+    if (positions.empty()) {
+        throw std::runtime_error("Unexpected end of input");
+    }
+
+    // Same as JsonParser::parse, nothing but white space may follow the root value
+    if (skipValue(0) != positions.size()) {
+        throw std::runtime_error("Unexpected tokens after the end of the JSON input");
+    }
+}
+
+LazyValue LazyDocument::getRoot() const {
+    return {this, 0};
+}
+
+char LazyDocument::at(std::size_t entry) const {
+    if (entry >= positions.size()) {
+        throw std::runtime_error("Unexpected end of input");
+    }
+    return file.view()[positions[entry]];
+}
+
+std::size_t LazyDocument::skipValue(std::size_t entry) const {
+    const char c = at(entry);
+    if (c != '{' && c != '[') {
+        return entry + 1;
+    }
+
+    // Bracket matching over the index, strings and literals are single entries
+    const std::string_view input = file.view();
+    std::size_t depth = 0;
+    for (std::size_t i = entry; i < positions.size(); ++i) {
+        const char d = input[positions[i]];
+        if (d == '{' || d == '[') {
+            depth++;
+        } else if ((d == '}' || d == ']') && --depth == 0) {
+            return i + 1;
+        }
+    }
+
+    throw std::runtime_error("Expected a closing bracket for the JSON value");
+}
+
+std::string_view LazyDocument::span(std::size_t entry) const {
+    const std::string_view input = file.view();
+    const std::size_t next = skipValue(entry);
+    const std::size_t end = next < positions.size() ? positions[next] : input.size();
+    return input.substr(positions[entry], end - positions[entry]);
+}
+
+bool LazyDocument::keyEquals(std::size_t entry, std::string_view key) const {
+    const std::string_view input = file.view();
+
+    // The key ends at the last quote before its colon
+    std::size_t close = positions[entry + 1];
+    while (close > positions[entry] && input[close] != '"') {
+        close--;
+    }
+
+    const std::size_t start = positions[entry] + 1;
+    const std::string_view raw = input.substr(start, close - start);
+    if (raw.find('\\') == std::string_view::npos) {
+        return raw == key;
+    }
+
+    // Escaped key, compare its decoded form
+    JsonParser parser;
+    return parser.parse(input.substr(positions[entry], close + 1 - positions[entry])).getAsString() == key;
+}
+
+// -------------------------------------------------------
+
+char LazyValue::firstChar() const {
+    return document->at(entry);
+}
+
+bool LazyValue::isBool() const {
+    const char c = firstChar();
+    return c == 't' || c == 'f';
+}
+
+bool LazyValue::isNumber() const {
+    const char c = firstChar();
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+bool LazyValue::isString() const {
+    return firstChar() == '"';
+}
+
+bool LazyValue::isArray() const {
+    return firstChar() == '[';
+}
+
+bool LazyValue::isObject() const {
+    return firstChar() == '{';
+}
+
+bool LazyValue::isNull() const {
+    return firstChar() == 'n';
+}
+
+JsonValue::JsonString LazyValue::getAsString() const {
+    if (!isString()) {
+        throw std::runtime_error("Bad Access, not a string");
+    }
+    return materialize().getAsString();
+}
+
+JsonValue::JsonNumber LazyValue::getAsNumber() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsNumber();
+}
+
+JsonValue::JsonInteger LazyValue::getAsInteger() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsInteger();
+}
+
+JsonValue::JsonUnsigned LazyValue::getAsUnsigned() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsUnsigned();
+}
+
+JsonValue::JsonBool LazyValue::getAsBool() const {
+    if (!isBool()) {
+        throw std::runtime_error("Bad Access, not a boolean");
+    }
+    return materialize().getAsBool();
+}
+
+LazyValue LazyValue::operator[](std::string_view str) const {
+    if (!isObject()) {
+        throw std::runtime_error("JsonValue is not an Object");
+    }
+
+    std::size_t i = entry + 1;
+    while (document->at(i) != '}') {
+        if (document->at(i) != '"') {
+            throw std::runtime_error("Expected a string key in the JSON object");
+        }
+        if (document->at(i + 1) != ':') {
+            throw std::runtime_error("Expected a colon after the JSON object key");
+        }
+
+        if (document->keyEquals(i, str)) {
+            return {document, i + 2};
+        }
+
+        i = document->skipValue(i + 2);
+        if (document->at(i) == ',') {
+            i++;
+        }
+    }
+
+    throw std::runtime_error("Not able to find value to the given key");
+}
+
+LazyValue LazyValue::operator[](std::size_t idx) const {
+    if (!isArray()) {
+        throw std::runtime_error("JsonValue is not an Array");
+    }
+
+    std::size_t i = entry + 1;
+    for (std::size_t n = 0; document->at(i) != ']'; ++n) {
+        if (n == idx) {
+            return {document, i};
+        }
+
+        i = document->skipValue(i);
+        if (document->at(i) == ',') {
+            i++;
+        }
+    }
+
+    throw std::runtime_error("Index out of range, unable to access array");
+}
+
+LazyValue LazyValue::at(const JsonValue::pathInJson &path) const {
+    LazyValue current = *this;
+
+    for (const auto &key : path) {
+        std::visit([&](auto&& arg) {
+            current = current[arg];
+        }, key);
+    }
+    return current;
+}
+
+std::size_t LazyValue::size() const {
+    const bool object = isObject();
+    if (!object && !isArray()) {
+        throw std::runtime_error("JsonValue is not an Object or an Array");
+    }
+
+    const char close = object ? '}' : ']';
+    std::size_t count = 0;
+    std::size_t i = entry + 1;
+    while (document->at(i) != close) {
+        // Skip the key and the colon of a member
+        i = document->skipValue(object ? i + 2 : i);
+        if (document->at(i) == ',') {
+            i++;
+        }
+        count++;
+    }
+    return count;
+}
+
+JsonValue LazyValue::materialize() const {
+    JsonParser parser;
+    return parser.parse(raw());
+}
+
+std::string_view LazyValue::raw() const {
+    return document->span(entry);
+}
@@ -0,0 +1,122 @@
+#include "../include/MappedFile.h"
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JSON_HAVE_MMAP 1
+#endif
+
+
+MappedFile::MappedFile(const std::string &filename) {
+
+#ifdef JSON_HAVE_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Unable to open file");
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // The parser reads the file front to back, let the kernel read ahead
+            ::madvise(addr, std::size_t(st.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char*>(addr);
+            length = std::size_t(st.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+
+    if (mapped) {
+        return;
+    }
+#endif
+
+    // Pipes, empty files or systems without mmap
+    readWhole(filename);
+}
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data(other.data), length(other.length), mapped(other.mapped), buffer(std::move(other.buffer)) {
+
+    if (!mapped) {
+        data = buffer.data();
+    }
+    other.data = nullptr;
+    other.length = 0;
+    other.mapped = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        release();
+        data = other.data;
+        length = other.length;
+        mapped = other.mapped;
+        buffer = std::move(other.buffer);
+
+        if (!mapped) {
+            data = buffer.data();
+        }
+        other.data = nullptr;
+        other.length = 0;
+        other.mapped = false;
+    }
+    return *this;
+}
+
+std::string_view MappedFile::view() const {
+    return {data, length};
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
+
+void MappedFile::release() {
+#ifdef JSON_HAVE_MMAP
+    if (mapped) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+#endif
+    data = nullptr;
+    length = 0;
+    mapped = false;
+    buffer.clear();
+}
+
+void MappedFile::readWhole(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()){
+        throw std::runtime_error("Unable to open file");
+    }
+
+    // Size the buffer once and read it with a single call when the size is known
+    file.seekg(0, std::ios::end);
+    const std::streamoff size = file.tellg();
+    if (size > 0) {
+        file.seekg(0, std::ios::beg);
+        buffer.resize(std::size_t(size));
+        file.read(buffer.data(), size);
+        buffer.resize(std::size_t(file.gcount()));
+    } else {
+        // Not seekable, read it in large blocks
+        file.clear();
+        char block[1 << 16];
+        while (file.read(block, sizeof(block)) || file.gcount() > 0) {
+            buffer.append(block, std::size_t(file.gcount()));
+        }
+    }
+
+    data = buffer.data();
+    length = buffer.size();
+}
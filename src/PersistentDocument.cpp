@@ -0,0 +1,494 @@
+#include "../include/PersistentDocument.h"
+#include <variant>
+
+namespace {
+
+    using Member = PersistentValue::Member;
+
+    // Members of an object, and past JsonObject::indexThreshold members an open addressing table of their
+    // positions + 1 (0 is an empty slot), at most half full
+    struct ObjectData {
+        PersistentValue::Members members;
+        PersistentVector<std::uint32_t> index;
+    };
+
+    // Lookup in members and their table, std::vectors while an object is built, PersistentVectors afterwards
+    template <typename MemberList, typename Table>
+    std::size_t findIn(const MemberList& members, const Table& index, std::string_view key) {
+        if (index.empty()) {
+            for (std::size_t i = 0; i < members.size(); ++i) {
+                if (members[i].first == key) {
+                    return i;
+                }
+            }
+            return SIZE_MAX;
+        }
+
+        const std::size_t mask = index.size() - 1;
+        for (std::size_t slot = JsonKey::hashOf(key) & mask;; slot = (slot + 1) & mask) {
+            const std::uint32_t entry = index[slot];
+            if (entry == 0) {
+                return SIZE_MAX;
+            }
+            if (members[entry - 1].first == key) {
+                return entry - 1;
+            }
+        }
+    }
+
+    // First empty slot for the hash
+    template <typename Table>
+    std::size_t emptySlot(const Table& index, std::size_t hash) {
+        const std::size_t mask = index.size() - 1;
+        std::size_t slot = hash & mask;
+        while (index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // Table size for count members, none for small objects
+    std::size_t slotsFor(std::size_t count) {
+        if (count <= JsonObject::indexThreshold) {
+            return 0;
+        }
+        std::size_t slots = 64;
+        while (slots < 2 * count) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    PersistentVector<std::uint32_t> buildIndex(const PersistentValue::Members& members) {
+        std::vector<std::uint32_t> index(slotsFor(members.size()), 0);
+        if (!index.empty()) {
+            std::uint32_t position = 0;
+            for (const Member& member : members) {
+                index[emptySlot(index, member.first.hash())] = ++position;
+            }
+        }
+        return PersistentVector<std::uint32_t>(std::move(index));
+    }
+
+    // Same as JsonParser::parseObject, a repeated key keeps its first position and its last value,
+    // unless the keys are known to be unique
+    ObjectData makeObject(std::vector<Member>&& members, bool unique) {
+        if (unique) {
+            ObjectData data{PersistentValue::Members(std::move(members)), {}};
+            data.index = buildIndex(data.members);
+            return data;
+        }
+
+        std::vector<Member> kept;
+        std::vector<std::uint32_t> index(slotsFor(members.size()), 0);
+        kept.reserve(members.size());
+        for (Member& member : members) {
+            const std::size_t position = findIn(kept, index, member.first.view());
+            if (position != SIZE_MAX) {
+                kept[position].second = std::move(member.second);
+                continue;
+            }
+            if (!index.empty()) {
+                index[emptySlot(index, member.first.hash())] = std::uint32_t(kept.size() + 1);
+            }
+            kept.push_back(std::move(member));
+        }
+
+        // Fewer members than slotsFor expected when keys were repeated, the table is then just emptier
+        if (kept.size() <= JsonObject::indexThreshold) {
+            index.clear();
+        }
+        return ObjectData{PersistentValue::Members(std::move(kept)), PersistentVector<std::uint32_t>(std::move(index))};
+    }
+
+    // Copy of the object with a member whose key is not in it yet
+    ObjectData withMember(const ObjectData& data, Member&& member) {
+        const std::size_t hash = member.first.hash();
+        ObjectData copy{data.members.push_back(std::move(member)), data.index};
+
+        const std::size_t count = copy.members.size();
+        if (count > JsonObject::indexThreshold) {
+            if (copy.index.size() < 2 * count) {
+                copy.index = buildIndex(copy.members);
+            } else {
+                copy.index = copy.index.set(emptySlot(copy.index, hash), std::uint32_t(count));
+            }
+        }
+        return copy;
+    }
+}
+
+struct PersistentValue::Node {
+    std::variant<JsonValue::JsonString, Elements, ObjectData> data;
+
+    template <typename T>
+    explicit Node(T&& data) : data(std::forward<T>(data)) {}
+};
+
+PersistentValue::PersistentValue(const JsonValue &value) {
+    if (value.isString()) {
+        node = std::make_shared<const Node>(JsonValue::JsonString(value.getAsStringView()));
+    } else if (value.isArray()) {
+        std::vector<PersistentValue> elements;
+        elements.reserve(value.getAsArray().size());
+        for (const JsonValue& element : value.getAsArray()) {
+            elements.emplace_back(element);
+        }
+        node = std::make_shared<const Node>(Elements(std::move(elements)));
+    } else if (value.isObject()) {
+        // Keys are copied, the ones interned by a JsonDocument would not outlive it
+        std::vector<Member> members;
+        members.reserve(value.getAsObject().size());
+        for (const auto& member : value.getAsObject()) {
+            members.emplace_back(JsonKey(member.first.view()), PersistentValue(member.second));
+        }
+        node = std::make_shared<const Node>(makeObject(std::move(members), true));
+    } else {
+        inlineValue = value;
+    }
+}
+
+PersistentValue PersistentValue::array(std::vector<PersistentValue> elements) {
+    return PersistentValue(std::make_shared<const Node>(Elements(std::move(elements))));
+}
+
+PersistentValue PersistentValue::object(std::vector<Member> members) {
+    return PersistentValue(std::make_shared<const Node>(makeObject(std::move(members), false)));
+}
+
+bool PersistentValue::isBool() const {
+    return inlineValue.isBool();
+}
+
+bool PersistentValue::isNumber() const {
+    return inlineValue.isNumber();
+}
+
+bool PersistentValue::isInteger() const {
+    return inlineValue.isInteger();
+}
+
+bool PersistentValue::isUnsigned() const {
+    return inlineValue.isUnsigned();
+}
+
+bool PersistentValue::isString() const {
+    return node && std::holds_alternative<JsonValue::JsonString>(node->data);
+}
+
+bool PersistentValue::isArray() const {
+    return node && std::holds_alternative<Elements>(node->data);
+}
+
+bool PersistentValue::isObject() const {
+    return node && std::holds_alternative<ObjectData>(node->data);
+}
+
+bool PersistentValue::isNull() const {
+    return !node && inlineValue.isNull();
+}
+
+const JsonValue::JsonString& PersistentValue::getAsString() const {
+    if (!isString()) {
+        throw std::runtime_error("Bad Access, not a string");
+    }
+    return std::get<JsonValue::JsonString>(node->data);
+}
+
+std::string_view PersistentValue::getAsStringView() const {
+    return getAsString();
+}
+
+// Strings and containers hold a null inline value, which throws
+JsonValue::JsonNumber PersistentValue::getAsNumber() const {
+    return inlineValue.getAsNumber();
+}
+
+JsonValue::JsonInteger PersistentValue::getAsInteger() const {
+    return inlineValue.getAsInteger();
+}
+
+JsonValue::JsonUnsigned PersistentValue::getAsUnsigned() const {
+    return inlineValue.getAsUnsigned();
+}
+
+JsonValue::JsonBool PersistentValue::getAsBool() const {
+    return inlineValue.getAsBool();
+}
+
+const PersistentValue::Elements& PersistentValue::getAsArray() const {
+    if (!isArray()) {
+        throw std::runtime_error("Bad Access, not an array");
+    }
+    return std::get<Elements>(node->data);
+}
+
+const PersistentValue::Members& PersistentValue::getAsObject() const {
+    if (!isObject()) {
+        throw std::runtime_error("Bad Access, not an object");
+    }
+    return std::get<ObjectData>(node->data).members;
+}
+
+std::size_t PersistentValue::findMember(std::string_view key) const {
+    const ObjectData& data = std::get<ObjectData>(node->data);
+    return findIn(data.members, data.index, key);
+}
+
+const PersistentValue& PersistentValue::operator[](std::string_view str) const {
+    if (!isObject()) {
+        throw std::runtime_error("JsonValue is not an Object");
+    }
+
+    const std::size_t position = findMember(str);
+    if (position == SIZE_MAX) {
+        throw std::runtime_error("Not able to find value to the given key");
+    }
+    return getAsObject()[position].second;
+}
+
+const PersistentValue& PersistentValue::operator[](std::size_t idx) const {
+    if (!isArray()) {
+        throw std::runtime_error("JsonValue is not an Array");
+    }
+
+    const Elements& elements = getAsArray();
+    if (idx >= elements.size()) {
+        throw std::runtime_error("Index out of range, unable to access array");
+    }
+    return elements[idx];
+}
+
+const PersistentValue& PersistentValue::at(const JsonValue::pathInJson &path) const {
+    const PersistentValue* current = this;
+
+    for (const auto &key : path) {
+        std::visit([&](auto&& arg) {
+            current = &(*current)[arg];
+        }, key);
+    }
+    return *current;
+}
+
+std::size_t PersistentValue::size() const {
+    if (isObject()) {
+        return getAsObject().size();
+    }
+    if (isArray()) {
+        return getAsArray().size();
+    }
+    throw std::runtime_error("JsonValue is not an Object or an Array");
+}
+
+JsonValue PersistentValue::materialize() const {
+    if (isString()) {
+        return JsonValue(JsonValue::JsonString(getAsString()));
+    }
+
+    if (isArray()) {
+        JsonValue::JsonArray arr;
+        arr.reserve(getAsArray().size());
+        for (const PersistentValue& element : getAsArray()) {
+            arr.push_back(element.materialize());
+        }
+        return JsonValue(std::move(arr));
+    }
+
+    if (isObject()) {
+        JsonValue::JsonObject obj;
+        obj.reserve(getAsObject().size());
+        for (const auto& member : getAsObject()) {
+            obj.insert_or_assign(JsonKey(member.first), member.second.materialize());
+        }
+        return JsonValue(std::move(obj));
+    }
+
+    return inlineValue;
+}
+
+PersistentValue PersistentValue::update(const JsonValue::pathInJson &path, const Change &change) const {
+    return updateFrom(path, 0, change);
+}
+
+PersistentValue PersistentValue::updateFrom(const JsonValue::pathInJson &path, std::size_t depth, const Change &change) const {
+    if (depth == path.size()) {
+        return change(*this);
+    }
+
+    // The child is replaced first, then this container is copied with it: the copy shares every other child
+    return std::visit([&](auto&& arg) -> PersistentValue {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, std::size_t>) {
+            if (!isArray()) {
+                throw std::runtime_error("Expected array but got different type");
+            }
+            const Elements& elements = getAsArray();
+            if (arg >= elements.size()) {
+                throw std::runtime_error("Index out of range, unable to access array");
+            }
+
+            PersistentValue child = elements[arg].updateFrom(path, depth + 1, change);
+            return PersistentValue(std::make_shared<const Node>(elements.set(arg, std::move(child))));
+        } else {
+            if (!isObject()) {
+                throw std::runtime_error("Expected object but got different type");
+            }
+            const ObjectData& data = std::get<ObjectData>(node->data);
+            const std::size_t position = findIn(data.members, data.index, arg);
+
+            if (position == SIZE_MAX) {
+                if (depth + 1 != path.size()) {
+                    throw std::runtime_error("Not able to find value to the given key");
+                }
+                PersistentValue child = change(PersistentValue());
+                return PersistentValue(std::make_shared<const Node>(withMember(data, Member(JsonKey(arg), std::move(child)))));
+            }
+
+            Member member(data.members[position].first, data.members[position].second.updateFrom(path, depth + 1, change));
+            return PersistentValue(std::make_shared<const Node>(ObjectData{data.members.set(position, std::move(member)), data.index}));
+        }
+    }, path[depth]);
+}
+
+PersistentValue PersistentValue::set(const JsonValue::pathInJson &path, PersistentValue value) const {
+    return update(path, [&](const PersistentValue&) { return value; });
+}
+
+PersistentValue PersistentValue::erase(const JsonValue::pathInJson &path) const {
+    if (path.empty()) {
+        throw std::runtime_error("Unable to erase the root");
+    }
+
+    const JsonValue::pathInJson parent(path.begin(), std::prev(path.end()));
+    return update(parent, [&](const PersistentValue& container) {
+        return std::visit([&](auto&& arg) -> PersistentValue {
+            using T = std::decay_t<decltype(arg)>;
+            if constexpr (std::is_same_v<T, std::size_t>) {
+                if (!container.isArray()) {
+                    throw std::runtime_error("Expected array but got different type");
+                }
+                const Elements& elements = container.getAsArray();
+                if (arg >= elements.size()) {
+                    throw std::runtime_error("Index out of range, unable to access array");
+                }
+
+                std::vector<PersistentValue> rest;
+                rest.reserve(elements.size() - 1);
+                std::size_t i = 0;
+                for (const PersistentValue& element : elements) {
+                    if (i++ != arg) {
+                        rest.push_back(element);
+                    }
+                }
+                return array(std::move(rest));
+            } else {
+                if (!container.isObject()) {
+                    throw std::runtime_error("Expected object but got different type");
+                }
+                const std::size_t position = container.findMember(arg);
+                if (position == SIZE_MAX) {
+                    throw std::runtime_error("Not able to find value to the given key");
+                }
+
+                const Members& members = container.getAsObject();
+                std::vector<Member> rest;
+                rest.reserve(members.size() - 1);
+                std::size_t i = 0;
+                for (const Member& member : members) {
+                    if (i++ != position) {
+                        rest.push_back(member);
+                    }
+                }
+                return PersistentValue(std::make_shared<const Node>(makeObject(std::move(rest), true)));
+            }
+        }, path.back());
+    });
+}
+
+PersistentValue PersistentValue::append(const JsonValue::pathInJson &path, PersistentValue value) const {
+    return update(path, [&](const PersistentValue& container) {
+        if (!container.isArray()) {
+            throw std::runtime_error("Expected array but got different type");
+        }
+
+        return PersistentValue(std::make_shared<const Node>(container.getAsArray().push_back(value)));
+    });
+}
+
+// -------------------------------------------------------
+
+PersistentDocument::Reader::Reader(const PersistentDocument &document) : document(document) {
+    // The version is read first, a change published in between is picked up by the next get()
+    seenVersion = document.version();
+    current = document.load();
+}
+
+const PersistentValue& PersistentDocument::Reader::get() {
+    const std::uint64_t latest = document.version();
+    if (latest != seenVersion) {
+        seenVersion = latest;
+        current = document.load();
+    }
+    return *current;
+}
+
+PersistentDocument::PersistentDocument(PersistentValue root)
+    : root(std::make_shared<const PersistentValue>(std::move(root))) {}
+
+PersistentDocument::PersistentDocument(const JsonValue &root) : PersistentDocument(PersistentValue(root)) {}
+
+std::shared_ptr<const PersistentValue> PersistentDocument::load() const {
+    return std::atomic_load(&root);
+}
+
+void PersistentDocument::store(PersistentValue &&newRoot) {
+    std::atomic_store(&root, std::make_shared<const PersistentValue>(std::move(newRoot)));
+    currentVersion.fetch_add(1, std::memory_order_release);
+}
+
+PersistentValue PersistentDocument::snapshot() const {
+    return *load();
+}
+
+std::uint64_t PersistentDocument::version() const {
+    return currentVersion.load(std::memory_order_acquire);
+}
+
+void PersistentDocument::publish(PersistentValue newRoot) {
+    std::lock_guard<std::mutex> lock(writer);
+    store(std::move(newRoot));
+}
+
+PersistentValue PersistentDocument::update(const PersistentValue::Change &change) {
+    std::lock_guard<std::mutex> lock(writer);
+    PersistentValue next = change(*load());
+    store(PersistentValue(next));
+    return next;
+}
+
+void PersistentDocument::modifyJson(const JsonValue::pathInJson &path, const JsonValue &value) {
+    // Converted before taking the lock, so other writers do not wait for it
+    const PersistentValue converted(value);
+    update([&](const PersistentValue& current) { return current.set(path, converted); });
+}
+
+void PersistentDocument::addToObject(const JsonValue::pathInJson &path, std::string_view key, const JsonValue &value) {
+    JsonValue::pathInJson member(path);
+    member.emplace_back(std::string(key));
+    const PersistentValue converted(value);
+    update([&](const PersistentValue& current) {
+        if (!current.at(path).isObject()) {
+            throw std::runtime_error("Path does not lead to an object");
+        }
+        return current.set(member, converted);
+    });
+}
+
+void PersistentDocument::addToArray(const JsonValue::pathInJson &path, const JsonValue &value) {
+    const PersistentValue converted(value);
+    update([&](const PersistentValue& current) { return current.append(path, converted); });
+}
+
+void PersistentDocument::erase(const JsonValue::pathInJson &path) {
+    update([&](const PersistentValue& current) { return current.erase(path); });
+}
@@ -0,0 +1,455 @@
+#include "../include/SourceMap.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonWriter.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JSON_HAVE_PWRITE 1
+#endif
+
+namespace {
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    bool endsLiteral(char c) {
+        return isSpace(c) || c == ',' || c == ':' || c == '{' || c == '}' || c == '[' || c == ']';
+    }
+
+    bool bySpanBegin(const SourceMap::Span& span, std::uint64_t begin) {
+        return span.begin < begin;
+    }
+
+#ifdef JSON_HAVE_PWRITE
+    // Write all of text at offset, false on error
+    bool writeAt(int fd, std::string_view text, std::uint64_t offset) {
+        while (!text.empty()) {
+            const ssize_t written = ::pwrite(fd, text.data(), text.size(), off_t(offset));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            text.remove_prefix(std::size_t(written));
+            offset += std::uint64_t(written);
+        }
+        return true;
+    }
+#endif
+}
+
+std::string_view SourceMap::text() const {
+    return file.view();
+}
+
+std::vector<SourceMap::Splice> SourceMap::diff(const JsonValue &value) const {
+    std::vector<Splice> splices;
+    std::size_t cursor = 0;
+    diffValue(value, itemAt(0, 0, skipWhitespace(0), cursor), splices, nullptr);
+    return splices;
+}
+
+void SourceMap::write(const std::string &newFileName, const JsonValue &value) {
+    Walked walked;
+    std::vector<Splice> splices;
+    std::size_t cursor = 0;
+    diffValue(value, itemAt(0, 0, skipWhitespace(0), cursor), splices, &walked);
+    for (const WalkedContainer& container : walked) {
+        container.value->clearCachedHash();
+    }
+
+    const bool overSource = isSource(newFileName);
+
+#ifdef JSON_HAVE_PWRITE
+    const bool fits = std::all_of(splices.begin(), splices.end(), [](const Splice& splice) {
+        return splice.text.size() <= splice.end - splice.begin;
+    });
+    if (overSource && fits) {
+        const int fd = ::open(newFileName.c_str(), O_WRONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Unable to open file");
+        }
+
+        std::string padded;
+        for (const Splice& splice : splices) {
+            padded = splice.text;
+            padded.resize(splice.end - splice.begin, ' ');
+            if (!writeAt(fd, padded, splice.begin)) {
+                ::close(fd);
+                throw std::runtime_error("Unable to write file");
+            }
+        }
+        ::close(fd);
+
+        followInPlace(splices, walked);
+        return;
+    }
+#endif
+
+    // The source stays mapped while it is copied, so it is only replaced once the new text is complete
+    const std::string output = overSource ? newFileName + ".tmp" : newFileName;
+    std::ofstream out(output, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Unable to open file");
+    }
+
+    const std::string_view source = text();
+    std::uint64_t pos = 0;
+    for (const Splice& splice : splices) {
+        out.write(source.data() + pos, std::streamsize(splice.begin - pos));
+        out.write(splice.text.data(), std::streamsize(splice.text.size()));
+        pos = splice.end;
+    }
+    out.write(source.data() + pos, std::streamsize(source.size() - pos));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Unable to write file");
+    }
+
+    if (overSource && std::rename(output.c_str(), newFileName.c_str()) != 0) {
+        throw std::runtime_error("Unable to replace file");
+    }
+}
+
+void SourceMap::open(const std::string &name) {
+    filename = name;
+    file = MappedFile(name);
+    spans.clear();
+
+#ifdef JSON_HAVE_PWRITE
+    struct stat st{};
+    if (::stat(name.c_str(), &st) == 0) {
+        device = std::uint64_t(st.st_dev);
+        inode = std::uint64_t(st.st_ino);
+    }
+#endif
+}
+
+bool SourceMap::isSource(const std::string &name) const {
+#ifdef JSON_HAVE_PWRITE
+    // Same file whatever the path, and not the same path once the source was replaced
+    struct stat st{};
+    return ::stat(name.c_str(), &st) == 0 && std::uint64_t(st.st_dev) == device && std::uint64_t(st.st_ino) == inode;
+#else
+    return name == filename;
+#endif
+}
+
+const SourceMap::Span* SourceMap::findSpan(std::uint64_t begin, std::size_t from) const {
+    // Galloping from the hint: the next sibling of a container is usually a few spans after it
+    std::size_t bound = from;
+    std::size_t step = 1;
+    while (bound < spans.size() && spans[bound].begin < begin) {
+        from = bound + 1;
+        bound += step;
+        step *= 2;
+    }
+    const auto last = spans.begin() + std::ptrdiff_t(std::min(bound + 1, spans.size()));
+    const auto it = std::lower_bound(spans.begin() + std::ptrdiff_t(std::min(from, spans.size())), last, begin, bySpanBegin);
+    if (it == last || it->begin != begin || it->hash == 0) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::uint64_t SourceMap::skipWhitespace(std::uint64_t pos) const {
+    const std::string_view source = text();
+    while (pos < source.size() && isSpace(source[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+SourceMap::Item SourceMap::itemAt(std::uint64_t start, std::uint64_t keyEnd, std::uint64_t begin, std::size_t &cursor) const {
+    const std::string_view source = text();
+    Item item{start, keyEnd, begin, begin, nullptr};
+    if (begin >= source.size()) {
+        return item;
+    }
+
+    const char first = source[begin];
+    if (first == '"') {
+        item.valueEnd = stringEnd(begin);
+    } else if (first == '{' || first == '[') {
+        item.span = findSpan(begin, cursor);
+        if (item.span) {
+            item.valueEnd = item.span->end;
+            cursor = std::size_t(item.span - spans.data()) + 1;
+        } else {
+            item.valueEnd = containerEnd(begin); // written since the file was read
+        }
+    } else {
+        while (item.valueEnd < source.size() && !endsLiteral(source[item.valueEnd])) {
+            item.valueEnd++;
+        }
+    }
+    return item;
+}
+
+std::uint64_t SourceMap::containerEnd(std::uint64_t begin) const {
+    const std::string_view source = text();
+    std::size_t depth = 0;
+    std::uint64_t pos = begin;
+    while (pos < source.size()) {
+        const char c = source[pos];
+        if (c == '"') {
+            pos = stringEnd(pos);
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return pos + 1;
+        }
+        pos++;
+    }
+    return pos;
+}
+
+std::uint64_t SourceMap::stringEnd(std::uint64_t begin) const {
+    const std::string_view source = text();
+    std::uint64_t pos = begin + 1;
+    while (true) {
+        pos = source.find_first_of("\"\\", pos);
+        if (pos == std::string_view::npos) {
+            return source.size();
+        }
+        if (source[pos] == '"') {
+            return pos + 1;
+        }
+        pos += 2; // escaped character
+    }
+}
+
+std::string SourceMap::decode(std::string_view token) {
+    if (token.find('\\') == std::string_view::npos) {
+        return std::string(token.substr(1, token.size() - 2));
+    }
+    return std::string(JsonParser().parse(token).getAsStringView());
+}
+
+bool SourceMap::sameScalar(const JsonValue &value, std::string_view token) {
+    if (token.empty() || token[0] == '{' || token[0] == '[') {
+        return false;
+    }
+    if (token[0] == '"') {
+        if (!value.isString()) {
+            return false;
+        }
+        if (token.find('\\') == std::string_view::npos) {
+            return value.getAsStringView() == token.substr(1, token.size() - 2);
+        }
+        return value.getAsStringView() == decode(token);
+    }
+    return !value.isString() && JsonParser::parseLiteral(token) == value;
+}
+
+bool SourceMap::unchanged(const JsonValue &value, const Item &item) const {
+    if (value.isObject() || value.isArray()) {
+        return item.span && item.span->hash == value.cachedHash();
+    }
+    return sameScalar(value, text().substr(item.valueBegin, item.valueEnd - item.valueBegin));
+}
+
+void SourceMap::diffValue(const JsonValue &value, const Item &item, std::vector<Splice> &splices, Walked *walked) const {
+    const char first = text()[item.valueBegin];
+    if ((value.isObject() && first == '{') || (value.isArray() && first == '[')) {
+        // Equal to its text while the hash cached is the one recorded, otherwise compared member by member
+        if (item.span && item.span->hash == value.cachedHash()) {
+            return;
+        }
+
+        if (value.isObject()) {
+            diffObject(value, item, splices, walked);
+        } else {
+            diffArray(value, item, splices, walked);
+        }
+        if (walked && item.span) {
+            walked->push_back({item.valueBegin, value.hash(), &value});
+        }
+        return;
+    }
+
+    if (!sameScalar(value, text().substr(item.valueBegin, item.valueEnd - item.valueBegin))) {
+        splices.push_back({item.valueBegin, item.valueEnd, JsonWriter::toString(value)});
+    }
+}
+
+void SourceMap::diffObject(const JsonValue &value, const Item &container, std::vector<Splice> &splices, Walked *walked) const {
+    std::vector<std::string> keys;
+    const std::vector<Item> items = itemsOf(container, &keys);
+    const JsonValue::JsonObject& object = value.getAsObject();
+
+    // A key repeated in the text is parsed as one member, which cannot be matched with its text
+    std::vector<std::string_view> sorted(keys.begin(), keys.end());
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+        splices.push_back({container.valueBegin, container.valueEnd, JsonWriter::toString(value)});
+        return;
+    }
+
+    // Members removed before the last one kept go with the separator after them, the ones after it with the
+    // separator before them
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (object.find(keys[i]) != object.end()) {
+            kept = i + 1;
+        }
+    }
+
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        const auto member = object.find(keys[i]);
+        if (member != object.end()) {
+            diffValue(member->second, items[i], splices, walked);
+        } else if (i + 1 < kept) {
+            splices.push_back({items[i].start, items[i + 1].start, {}});
+        }
+    }
+
+    // Members added, after the last one kept and in the order of the object
+    std::string added;
+    const std::string between = separator(container.valueBegin, items);
+    const std::string_view colon = items.empty() ? std::string_view(":")
+        : text().substr(items[0].keyEnd, items[0].valueBegin - items[0].keyEnd);
+    for (const auto& [key, child] : object) {
+        if (std::binary_search(sorted.begin(), sorted.end(), key.view())) {
+            continue;
+        }
+        if (kept > 0 || !added.empty()) {
+            added += between;
+        }
+        added += JsonWriter::toString(JsonValue(JsonValue::JsonString(key.view())));
+        added += colon;
+        added += JsonWriter::toString(child);
+    }
+
+    if (kept < items.size()) {
+        splices.push_back({kept > 0 ? items[kept - 1].valueEnd : items[0].start, items.back().valueEnd, std::move(added)});
+    } else if (!added.empty()) {
+        const std::uint64_t at = items.empty() ? container.valueBegin + 1 : items.back().valueEnd;
+        splices.push_back({at, at, std::move(added)});
+    }
+}
+
+void SourceMap::diffArray(const JsonValue &value, const Item &container, std::vector<Splice> &splices, Walked *walked) const {
+    const std::vector<Item> items = itemsOf(container, nullptr);
+    const JsonValue::JsonArray& array = value.getAsArray();
+    const std::size_t count = array.size();
+    const std::size_t original = items.size();
+
+    // Elements unchanged at both ends, the ones in between are compared by position and the extra ones
+    // removed or inserted together, so inserting or removing a few elements only splices them
+    std::size_t prefix = 0;
+    while (prefix < count && prefix < original && unchanged(array[prefix], items[prefix])) {
+        prefix++;
+    }
+    std::size_t suffix = 0;
+    while (suffix < count - prefix && suffix < original - prefix
+           && unchanged(array[count - 1 - suffix], items[original - 1 - suffix])) {
+        suffix++;
+    }
+
+    const std::size_t from = std::min(count, original) - suffix;
+    for (std::size_t i = prefix; i < from; ++i) {
+        diffValue(array[i], items[i], splices, walked);
+    }
+
+    if (original > from + suffix) {
+        if (suffix > 0) {
+            splices.push_back({items[from].start, items[original - suffix].start, {}});
+        } else if (from > 0) {
+            splices.push_back({items[from - 1].valueEnd, items.back().valueEnd, {}});
+        } else {
+            splices.push_back({items[0].start, items.back().valueEnd, {}});
+        }
+    } else if (count > from + suffix) {
+        const std::string between = separator(container.valueBegin, items);
+        std::string inserted;
+        std::uint64_t at;
+        if (suffix > 0) {
+            for (std::size_t i = from; i < count - suffix; ++i) {
+                inserted += JsonWriter::toString(array[i]);
+                inserted += between;
+            }
+            at = items[original - suffix].start;
+        } else {
+            for (std::size_t i = from; i < count; ++i) {
+                if (original > 0 || i > from) {
+                    inserted += between;
+                }
+                inserted += JsonWriter::toString(array[i]);
+            }
+            at = original > 0 ? items.back().valueEnd : container.valueBegin + 1;
+        }
+        splices.push_back({at, at, std::move(inserted)});
+    }
+}
+
+std::vector<SourceMap::Item> SourceMap::itemsOf(const Item &container, std::vector<std::string> *keys) const {
+    const std::string_view source = text();
+    const bool isObject = source[container.valueBegin] == '{';
+    const char close = isObject ? '}' : ']';
+
+    // The spans of the children follow the one of the container
+    std::size_t cursor = container.span ? std::size_t(container.span - spans.data()) + 1 : 0;
+
+    std::vector<Item> items;
+    std::uint64_t pos = skipWhitespace(container.valueBegin + 1);
+    while (pos < source.size() && source[pos] != close) {
+        std::uint64_t keyEnd = pos;
+        std::uint64_t begin = pos;
+        if (isObject) {
+            keyEnd = stringEnd(pos);
+            keys->push_back(decode(source.substr(pos, keyEnd - pos)));
+            begin = skipWhitespace(skipWhitespace(keyEnd) + 1); // past the colon
+        }
+        items.push_back(itemAt(pos, keyEnd, begin, cursor));
+
+        pos = skipWhitespace(items.back().valueEnd);
+        if (pos < source.size() && source[pos] == ',') {
+            pos = skipWhitespace(pos + 1);
+        }
+    }
+    return items;
+}
+
+std::string SourceMap::separator(std::uint64_t begin, const std::vector<Item> &items) const {
+    const std::string_view source = text();
+    if (items.size() >= 2) {
+        return std::string(source.substr(items[0].valueEnd, items[1].start - items[0].valueEnd));
+    }
+    if (items.size() == 1) {
+        return "," + std::string(source.substr(begin + 1, items[0].start - begin - 1));
+    }
+    return ",";
+}
+
+void SourceMap::followInPlace(const std::vector<Splice> &splices, const Walked &walked) {
+    if (!splices.empty()) {
+        file = MappedFile(filename);
+    }
+
+    // The containers inside the bytes replaced are gone, or now scanned when they are part of the new text
+    for (const Splice& splice : splices) {
+        auto it = std::lower_bound(spans.begin(), spans.end(), splice.begin, bySpanBegin);
+        for (; it != spans.end() && it->begin < splice.end; ++it) {
+            it->hash = 0;
+        }
+    }
+
+    // The ones walked kept their bytes, which are now the text of their current value
+    for (const WalkedContainer& container : walked) {
+        const auto it = std::lower_bound(spans.begin(), spans.end(), container.begin, bySpanBegin);
+        if (it != spans.end() && it->begin == container.begin && it->hash != 0) {
+            it->hash = container.hash;
+        }
+    }
+}
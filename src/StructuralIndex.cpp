@@ -0,0 +1,357 @@
+#include "../include/StructuralIndex.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define JSON_HAVE_X86_KERNELS 1
+#endif
+
+namespace {
+
+    using ClassifyFn = void (*)(const char*, StructuralIndex::BlockMasks&);
+    using FindFn = std::size_t (*)(const char*, std::size_t, std::size_t);
+
+    int trailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(bits);
+#else
+        int n = 0;
+        while (!(bits & 1)) { bits >>= 1; n++; }
+        return n;
+#endif
+    }
+
+    // Bit i of the result is the xor of the bits 0..i of the input, i.e. "inside a string" for a quote mask
+    uint64_t prefixXor(uint64_t bits) {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    bool addOverflow(uint64_t a, uint64_t b, uint64_t& sum) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_add_overflow(a, b, &sum);
+#else
+        sum = a + b;
+        return sum < a;
+#endif
+    }
+
+    // Characters preceded by an odd run of backslashes (see simdjson), carry is 1 when the
+    // first byte of the next block is escaped.
+    uint64_t escapedChars(uint64_t backslash, uint64_t& carry) {
+        const uint64_t evenBits = 0x5555555555555555ULL;
+
+        // An escaped first byte is not the start of a new escape, even if it is a backslash
+        backslash &= ~carry;
+        const uint64_t followsEscape = (backslash << 1) | carry;
+
+        // Runs starting on odd bits are cleared by the addition, runs starting on even bits
+        // leave their end bit behind
+        const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+        uint64_t evenSequences;
+        carry = addOverflow(oddStarts, backslash, evenSequences) ? 1 : 0;
+        const uint64_t invertMask = evenSequences << 1;
+
+        return (evenBits ^ invertMask) & followsEscape;
+    }
+
+    // ------------------------------------------------------- Scalar kernels
+
+    void classifyScalar(const char* block, StructuralIndex::BlockMasks& masks) {
+        masks = {0, 0, 0, 0};
+        for (int i = 0; i < 64; ++i) {
+            const uint64_t bit = uint64_t(1) << i;
+            switch (block[i]) {
+                case '"': masks.quote |= bit; break;
+                case '\\': masks.backslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',':
+                    masks.op |= bit; break;
+                case ' ': case '\t': case '\n': case '\r':
+                    masks.whitespace |= bit; break;
+                default: break;
+            }
+        }
+    }
+
+    std::size_t findStringSpecialScalar(const char* data, std::size_t from, std::size_t size) {
+        while (from < size) {
+            const auto c = static_cast<unsigned char>(data[from]);
+            if (c == '"' || c == '\\' || c < 0x20) {
+                return from;
+            }
+            from++;
+        }
+        return size;
+    }
+
+#ifdef JSON_HAVE_X86_KERNELS
+
+    // ------------------------------------------------------- SSE4.2 kernels
+
+    // Whitespace and operators are found with a lookup on the low nibble (see simdjson).
+    // '[' and ']' become '{' and '}' once 0x20 is or-ed in, so one table covers all six operators.
+    __attribute__((target("sse4.2")))
+    void classifySSE42(const char* block, StructuralIndex::BlockMasks& masks) {
+        const __m128i whitespaceTable = _mm_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2,
+                                                      100, '\t', '\n', 112, 100, '\r', 100, 100);
+        const __m128i opTable = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 0, ':', '{', ',', '}', 0, 0);
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i lowerCase = _mm_set1_epi8(0x20);
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        masks = {0, 0, 0, 0};
+        for (int i = 0; i < 4; ++i) {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+            const int shift = 16 * i;
+
+            const __m128i isOp = _mm_and_si128(
+                _mm_cmpeq_epi8(_mm_shuffle_epi8(opTable, in), _mm_or_si128(in, lowerCase)),
+                _mm_cmpgt_epi8(in, control));
+
+            masks.quote |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(in, quote)))) << shift;
+            masks.backslash |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(in, backslash)))) << shift;
+            masks.whitespace |= uint64_t(uint16_t(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_shuffle_epi8(whitespaceTable, in), in)))) << shift;
+            masks.op |= uint64_t(uint16_t(_mm_movemask_epi8(isOp))) << shift;
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    std::size_t findStringSpecialSSE42(const char* data, std::size_t from, std::size_t size) {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        while (from + 16 <= size) {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+            const __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(in, control), in));
+
+            const int mask = _mm_movemask_epi8(special);
+            if (mask != 0) {
+                return from + std::size_t(trailingZeros(uint64_t(mask)));
+            }
+            from += 16;
+        }
+        return findStringSpecialScalar(data, from, size);
+    }
+
+    // ------------------------------------------------------- AVX2 kernels
+
+    __attribute__((target("avx2")))
+    void classifyAVX2(const char* block, StructuralIndex::BlockMasks& masks) {
+        const __m256i whitespaceTable = _mm256_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2,
+                                                         100, '\t', '\n', 112, 100, '\r', 100, 100,
+                                                         ' ', 100, 100, 100, 17, 100, 113, 2,
+                                                         100, '\t', '\n', 112, 100, '\r', 100, 100);
+        const __m256i opTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0,
+                                                 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i lowerCase = _mm256_set1_epi8(0x20);
+        const __m256i control = _mm256_set1_epi8(0x1F);
+
+        masks = {0, 0, 0, 0};
+        for (int i = 0; i < 2; ++i) {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+            const int shift = 32 * i;
+
+            const __m256i isOp = _mm256_and_si256(
+                _mm256_cmpeq_epi8(_mm256_shuffle_epi8(opTable, in), _mm256_or_si256(in, lowerCase)),
+                _mm256_cmpgt_epi8(in, control));
+
+            masks.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, quote)))) << shift;
+            masks.backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, backslash)))) << shift;
+            masks.whitespace |= uint64_t(uint32_t(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_shuffle_epi8(whitespaceTable, in), in)))) << shift;
+            masks.op |= uint64_t(uint32_t(_mm256_movemask_epi8(isOp))) << shift;
+        }
+    }
+
+    __attribute__((target("avx2")))
+    std::size_t findStringSpecialAVX2(const char* data, std::size_t from, std::size_t size) {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1F);
+
+        while (from + 32 <= size) {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + from));
+            const __m256i special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(in, quote), _mm256_cmpeq_epi8(in, backslash)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(in, control), in));
+
+            const auto mask = uint32_t(_mm256_movemask_epi8(special));
+            if (mask != 0) {
+                return from + std::size_t(trailingZeros(mask));
+            }
+            from += 32;
+        }
+        return findStringSpecialScalar(data, from, size);
+    }
+
+#endif
+
+    StructuralIndex::Kernel detectKernel() {
+#ifdef JSON_HAVE_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return StructuralIndex::Kernel::AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.2")) {
+            return StructuralIndex::Kernel::SSE42;
+        }
+#endif
+        return StructuralIndex::Kernel::Scalar;
+    }
+
+    ClassifyFn classifyKernel() {
+        switch (StructuralIndex::activeKernel()) {
+#ifdef JSON_HAVE_X86_KERNELS
+            case StructuralIndex::Kernel::AVX2: return classifyAVX2;
+            case StructuralIndex::Kernel::SSE42: return classifySSE42;
+#endif
+            default: return classifyScalar;
+        }
+    }
+
+    FindFn findKernel() {
+        switch (StructuralIndex::activeKernel()) {
+#ifdef JSON_HAVE_X86_KERNELS
+            case StructuralIndex::Kernel::AVX2: return findStringSpecialAVX2;
+            case StructuralIndex::Kernel::SSE42: return findStringSpecialSSE42;
+#endif
+            default: return findStringSpecialScalar;
+        }
+    }
+}
+
+StructuralIndex::Kernel StructuralIndex::activeKernel() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+void StructuralIndex::classify(const char *block, BlockMasks &masks) {
+    static const ClassifyFn kernel = classifyKernel();
+    kernel(block, masks);
+}
+
+std::size_t StructuralIndex::findStringSpecial(std::string_view input, std::size_t from) {
+    static const FindFn kernel = findKernel();
+    return kernel(input.data(), from, input.size());
+}
+
+std::vector<uint32_t> StructuralIndex::build(std::string_view input) {
+    if (input.size() > UINT32_MAX) {
+        throw std::runtime_error("Input too large for a structural index");
+    }
+
+    // Written through a raw pointer, a block adds at most 64 positions
+    std::vector<uint32_t> positions(input.size() / 8 + 64);
+    std::size_t count = 0;
+
+    // State carried from one block to the next
+    uint64_t prevInString = 0;  // all ones when the previous block ended inside a string
+    uint64_t prevScalar = 0;    // 1 when the previous block ended inside a literal
+    uint64_t escapeCarry = 0;   // 1 when the first byte of this block is escaped
+
+    char padded[64];
+    BlockMasks masks{};
+
+    for (std::size_t base = 0; base < input.size(); base += 64) {
+        const char* block = input.data() + base;
+
+        // The last partial block is padded with white spaces
+        if (input.size() - base < 64) {
+            std::memset(padded, ' ', sizeof(padded));
+            std::memcpy(padded, block, input.size() - base);
+            block = padded;
+        }
+
+        if (positions.size() < count + 64) {
+            positions.resize(positions.size() * 2);
+        }
+        uint32_t* out = positions.data() + count;
+
+        classify(block, masks);
+
+        const uint64_t escaped = escapedChars(masks.backslash, escapeCarry);
+        const uint64_t quote = masks.quote & ~escaped;
+
+        // Inside a string: from an opening quote (included) to the closing quote (excluded)
+        const uint64_t inString = prefixXor(quote) ^ prevInString;
+        prevInString = uint64_t(int64_t(inString) >> 63);
+
+        // A literal starts at a byte that is neither white space nor an operator and does not follow one
+        const uint64_t scalar = ~(masks.op | masks.whitespace);
+        const uint64_t nonQuoteScalar = scalar & ~quote;
+        const uint64_t followsScalar = (nonQuoteScalar << 1) | prevScalar;
+        prevScalar = nonQuoteScalar >> 63;
+
+        // Keep the opening quote, drop everything inside the string and its closing quote
+        const uint64_t stringTail = inString ^ quote;
+        uint64_t structurals = (masks.op | quote | (scalar & ~followsScalar)) & ~stringTail;
+
+        while (structurals) {
+            *out++ = uint32_t(base + std::size_t(trailingZeros(structurals)));
+            structurals &= structurals - 1;
+        }
+        count = std::size_t(out - positions.data());
+    }
+
+    if (prevInString) {
+        throw std::runtime_error("Unterminated string in the JSON input");
+    }
+
+    positions.resize(count);
+    return positions;
+}
+
+StructuralIndex::Summary StructuralIndex::summarize(std::string_view input) {
+    // Outside of strings a valid document has no backslash, so the escapes do not depend on the
+    // state at the start and the state inside the part for a start inside a string is the complement
+    uint64_t prevInString = 0;
+    uint64_t escapeCarry = 0;
+    long depth[2] = {0, 0};
+
+    char padded[64];
+    BlockMasks masks{};
+
+    for (std::size_t base = 0; base < input.size(); base += 64) {
+        const char* block = input.data() + base;
+        if (input.size() - base < 64) {
+            std::memset(padded, ' ', sizeof(padded));
+            std::memcpy(padded, block, input.size() - base);
+            block = padded;
+        }
+
+        classify(block, masks);
+
+        const uint64_t escaped = escapedChars(masks.backslash, escapeCarry);
+        const uint64_t inString = prefixXor(masks.quote & ~escaped) ^ prevInString;
+        prevInString = uint64_t(int64_t(inString) >> 63);
+
+        for (int start = 0; start < 2; ++start) {
+            uint64_t ops = masks.op & (start == 0 ? ~inString : inString);
+            while (ops) {
+                switch (block[trailingZeros(ops)]) {
+                    case '{':
+                    case '[': depth[start]++; break;
+                    case '}':
+                    case ']': depth[start]--; break;
+                    default: break;
+                }
+                ops &= ops - 1;
+            }
+        }
+    }
+
+    return {{prevInString != 0, prevInString == 0}, {depth[0], depth[1]}};
+}
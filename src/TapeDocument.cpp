@@ -0,0 +1,405 @@
+#include "../include/TapeDocument.h"
+#include "../include/JsonStreamParser.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+    constexpr std::uint64_t payloadMask = (std::uint64_t(1) << 56) - 1;
+    constexpr std::uint64_t maxCount = 0xFFFFFF;
+
+    std::uint64_t makeEntry(char type, std::uint64_t payload) {
+        return (std::uint64_t(static_cast<unsigned char>(type)) << 56) | payload;
+    }
+}
+
+
+// Lays the events of a JsonStreamParser, or the nodes of a JsonValue, out on the tape
+class TapeDocument::Builder : public JsonHandler {
+
+public:
+    TapeDocument document;
+
+private:
+    // Entries of the open containers and their number of elements / members so far
+    std::vector<std::size_t> open;
+    std::vector<std::uint64_t> counts;
+
+public:
+
+    void startObject() override {
+        startContainer('{');
+    }
+
+    void key(std::string_view str) override {
+        counts.back()++;
+        addString(str);
+    }
+
+    void endObject() override {
+        endContainer('}');
+    }
+
+    void startArray() override {
+        startContainer('[');
+    }
+
+    void endArray() override {
+        endContainer(']');
+    }
+
+    void string(std::string_view str) override {
+        beforeValue();
+        addString(str);
+    }
+
+    void number(JsonValue::JsonNumber num) override {
+        std::uint64_t bits;
+        std::memcpy(&bits, &num, sizeof(bits));
+        addNumber('d', bits);
+    }
+
+    void integer(JsonValue::JsonInteger num) override {
+        addNumber('l', std::uint64_t(num));
+    }
+
+    void unsignedInteger(JsonValue::JsonUnsigned num) override {
+        addNumber('u', num);
+    }
+
+    void boolean(JsonValue::JsonBool b) override {
+        beforeValue();
+        document.tape.push_back(makeEntry(b ? 't' : 'f', 0));
+    }
+
+    void null() override {
+        beforeValue();
+        document.tape.push_back(makeEntry('n', 0));
+    }
+
+    // Same events for the nodes of a value
+    void add(const JsonValue& value) {
+        if (value.isObject()) {
+            startObject();
+            for (const auto& member : value.getAsObject()) {
+                key(member.first);
+                add(member.second);
+            }
+            endObject();
+        } else if (value.isArray()) {
+            startArray();
+            for (const JsonValue& element : value.getAsArray()) {
+                add(element);
+            }
+            endArray();
+        } else if (value.isString()) {
+            string(value.getAsStringView());
+        } else if (value.isInteger()) {
+            integer(value.getAsInteger());
+        } else if (value.isUnsigned()) {
+            unsignedInteger(value.getAsUnsigned());
+        } else if (value.isNumber()) {
+            number(value.getAsNumber());
+        } else if (value.isBool()) {
+            boolean(value.getAsBool());
+        } else {
+            null();
+        }
+    }
+
+private:
+
+    // Elements of an array are counted when they start, members of an object by their key
+    void beforeValue() {
+        if (!open.empty() && document.typeAt(open.back()) == '[') {
+            counts.back()++;
+        }
+    }
+
+    void startContainer(char type) {
+        beforeValue();
+        open.push_back(document.tape.size());
+        counts.push_back(0);
+        document.tape.push_back(makeEntry(type, 0));
+    }
+
+    void endContainer(char type) {
+        const std::size_t opening = open.back();
+        const std::uint64_t count = std::min(counts.back(), maxCount);
+        open.pop_back();
+        counts.pop_back();
+
+        document.tape.push_back(makeEntry(type, opening));
+        const std::size_t pastEnd = document.tape.size();
+        if (pastEnd > UINT32_MAX) {
+            throw std::runtime_error("Document too large for a tape");
+        }
+        document.tape[opening] |= std::uint64_t(pastEnd) | (count << 32);
+    }
+
+    void addString(std::string_view str) {
+        if (str.size() > UINT32_MAX || document.strings.size() > payloadMask) {
+            throw std::runtime_error("Document too large for a tape");
+        }
+
+        document.tape.push_back(makeEntry('"', document.strings.size()));
+        const std::uint32_t length = std::uint32_t(str.size());
+        document.strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        document.strings.append(str);
+    }
+
+    void addNumber(char type, std::uint64_t bits) {
+        beforeValue();
+        document.tape.push_back(makeEntry(type, 0));
+        document.tape.push_back(bits);
+    }
+};
+
+
+TapeDocument TapeDocument::parse(std::string_view input) {
+    Builder builder;
+    builder.document.tape.reserve(input.size() / 8);
+    builder.document.strings.reserve(input.size() / 2);
+
+    JsonStreamParser parser(builder);
+    parser.feed(input);
+    parser.finish();
+    return std::move(builder.document);
+}
+
+TapeDocument TapeDocument::fromValue(const JsonValue &value) {
+    Builder builder;
+    builder.add(value);
+    return std::move(builder.document);
+}
+
+TapeValue TapeDocument::getRoot() const {
+    if (tape.empty()) {
+        throw std::runtime_error("Empty tape document");
+    }
+    return {this, 0};
+}
+
+char TapeDocument::typeAt(std::size_t entry) const {
+    return char(tape[entry] >> 56);
+}
+
+std::uint64_t TapeDocument::payloadAt(std::size_t entry) const {
+    return tape[entry] & payloadMask;
+}
+
+std::string_view TapeDocument::stringAt(std::size_t entry) const {
+    const std::size_t offset = std::size_t(payloadAt(entry));
+    std::uint32_t length;
+    std::memcpy(&length, strings.data() + offset, sizeof(length));
+    return std::string_view(strings.data() + offset + sizeof(length), length);
+}
+
+// -------------------------------------------------------
+
+char TapeValue::type() const {
+    return document->typeAt(entry);
+}
+
+std::size_t TapeValue::next() const {
+    switch (type()) {
+        case '[':
+        case '{': return std::size_t(document->payloadAt(entry) & 0xFFFFFFFF);
+        case 'd':
+        case 'l':
+        case 'u': return entry + 2;
+        default: return entry + 1;
+    }
+}
+
+bool TapeValue::isBool() const {
+    return type() == 't' || type() == 'f';
+}
+
+bool TapeValue::isNumber() const {
+    const char t = type();
+    return t == 'd' || t == 'l' || t == 'u';
+}
+
+bool TapeValue::isInteger() const {
+    return type() == 'l';
+}
+
+bool TapeValue::isUnsigned() const {
+    return type() == 'u';
+}
+
+bool TapeValue::isString() const {
+    return type() == '"';
+}
+
+bool TapeValue::isArray() const {
+    return type() == '[';
+}
+
+bool TapeValue::isObject() const {
+    return type() == '{';
+}
+
+bool TapeValue::isNull() const {
+    return type() == 'n';
+}
+
+std::string_view TapeValue::getAsStringView() const {
+    if (!isString()) {
+        throw std::runtime_error("Bad Access, not a string");
+    }
+    return document->stringAt(entry);
+}
+
+JsonValue::JsonString TapeValue::getAsString() const {
+    return JsonValue::JsonString(getAsStringView());
+}
+
+JsonValue::JsonNumber TapeValue::getAsNumber() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsNumber();
+}
+
+JsonValue::JsonInteger TapeValue::getAsInteger() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsInteger();
+}
+
+JsonValue::JsonUnsigned TapeValue::getAsUnsigned() const {
+    if (!isNumber()) {
+        throw std::runtime_error("Bad Access, not a number");
+    }
+    return materialize().getAsUnsigned();
+}
+
+JsonValue::JsonBool TapeValue::getAsBool() const {
+    if (!isBool()) {
+        throw std::runtime_error("Bad Access, not a boolean");
+    }
+    return type() == 't';
+}
+
+TapeArray TapeValue::getAsArray() const {
+    if (!isArray()) {
+        throw std::runtime_error("Bad Access, not an array");
+    }
+    return TapeArray(document, entry + 1, next() - 1);
+}
+
+TapeObject TapeValue::getAsObject() const {
+    if (!isObject()) {
+        throw std::runtime_error("Bad Access, not an object");
+    }
+    return TapeObject(document, entry + 1, next() - 1);
+}
+
+TapeValue TapeValue::operator[](std::string_view str) const {
+    if (!isObject()) {
+        throw std::runtime_error("JsonValue is not an Object");
+    }
+
+    for (const auto& member : getAsObject()) {
+        if (member.first == str) {
+            return member.second;
+        }
+    }
+
+    throw std::runtime_error("Not able to find value to the given key");
+}
+
+TapeValue TapeValue::operator[](std::size_t idx) const {
+    if (!isArray()) {
+        throw std::runtime_error("JsonValue is not an Array");
+    }
+
+    std::size_t n = 0;
+    for (const TapeValue element : getAsArray()) {
+        if (n++ == idx) {
+            return element;
+        }
+    }
+
+    throw std::runtime_error("Index out of range, unable to access array");
+}
+
+TapeValue TapeValue::at(const JsonValue::pathInJson &path) const {
+    TapeValue current = *this;
+
+    for (const auto &key : path) {
+        std::visit([&](auto&& arg) {
+            current = current[arg];
+        }, key);
+    }
+    return current;
+}
+
+std::size_t TapeValue::size() const {
+    if (!isObject() && !isArray()) {
+        throw std::runtime_error("JsonValue is not an Object or an Array");
+    }
+
+    const std::size_t count = std::size_t((document->payloadAt(entry) >> 32) & maxCount);
+    if (count < maxCount) {
+        return count;
+    }
+
+    // Saturated count, walk the children
+    return isObject() ? std::size_t(std::distance(getAsObject().begin(), getAsObject().end()))
+                      : std::size_t(std::distance(getAsArray().begin(), getAsArray().end()));
+}
+
+JsonValue TapeValue::materialize() const {
+    const std::uint64_t bits = entry + 1 < document->tape.size() ? document->tape[entry + 1] : 0;
+
+    switch (type()) {
+        case 'n': return JsonValue();
+        case 't': return JsonValue(JsonValue::JsonBool(true));
+        case 'f': return JsonValue(JsonValue::JsonBool(false));
+        case 'd': {
+            JsonValue::JsonNumber num;
+            std::memcpy(&num, &bits, sizeof(num));
+            return JsonValue(num);
+        }
+        case 'l': return JsonValue(JsonValue::JsonInteger(bits));
+        case 'u': return JsonValue(JsonValue::JsonUnsigned(bits));
+        case '"': return JsonValue(getAsString());
+        case '[': {
+            JsonValue::JsonArray arr;
+            arr.reserve(size());
+            for (const TapeValue element : getAsArray()) {
+                arr.push_back(element.materialize());
+            }
+            return JsonValue(std::move(arr));
+        }
+        default: {
+            JsonValue::JsonObject obj;
+            obj.reserve(size());
+            for (const auto& member : getAsObject()) {
+                obj.insert_or_assign(JsonKey(member.first), member.second.materialize());
+            }
+            return JsonValue(std::move(obj));
+        }
+    }
+}
+
+// -------------------------------------------------------
+
+TapeArray::iterator& TapeArray::iterator::operator++() {
+    entry = TapeValue(document, entry).next();
+    return *this;
+}
+
+TapeObject::iterator::value_type TapeObject::iterator::operator*() const {
+    return {document->stringAt(entry), TapeValue(document, entry + 1)};
+}
+
+TapeObject::iterator& TapeObject::iterator::operator++() {
+    // Past the key, then past the value
+    entry = TapeValue(document, entry + 1).next();
+    return *this;
+}
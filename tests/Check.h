@@ -0,0 +1,42 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <exception>
+#include <iostream>
+
+// Minimal checks for the test programs: a failed check is reported and counted, and main returns
+// the result of checkResult() so that ctest sees the failure
+
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void checkThat(bool condition, const char* expression, const char* file, int line) {
+    if (!condition) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+        ++checkFailures();
+    }
+}
+
+// Whether calling f throws
+template <typename F>
+bool throws(F&& f) {
+    try {
+        f();
+    } catch (const std::exception&) {
+        return true;
+    }
+    return false;
+}
+
+inline int checkResult() {
+    if (checkFailures() != 0) {
+        std::cerr << checkFailures() << " check(s) failed" << std::endl;
+    }
+    return checkFailures() == 0 ? 0 : 1;
+}
+
+#define CHECK(condition) checkThat((condition), #condition, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,95 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonDocument.h"
+#include "../include/JsonPatch.h"
+#include <string>
+
+namespace {
+
+    const char* const text =
+        R"([{"a_rather_long_key_name_here": "a string value long enough not to fit in a small string", "k": "v"},)"
+        R"( {"a_rather_long_key_name_here": "another long string value, borrowed from the input copy", "k": "w"}])";
+
+    // Interned keys keep sharing the characters of the key table within the document, and own a copy once
+    // a container of another resource takes them over
+    void testKeysLeavingTheArena() {
+        JsonValue::JsonArray kept;
+        {
+            JsonDocument document = JsonParser().parseDocument(text);
+            JsonValue::JsonArray inside(document.getResource());
+            inside.push_back(std::move(document.getRoot()[1]));
+            CHECK(inside[0].getAsObject().begin()->first.isShared());
+
+            kept.push_back(std::move(document.getRoot()[0]));
+        }
+        const JsonKey& key = kept[0].getAsObject().begin()->first;
+        CHECK(!key.isShared());
+        CHECK(key.view() == "a_rather_long_key_name_here");
+        CHECK(kept[0]["k"].getAsStringView() == "v");
+    }
+
+    // Strings borrowed from the input copy of a document are copied when they leave its arena, whether
+    // alone or inside a container
+    void testBorrowedStringsLeavingTheArena() {
+        JsonValue::JsonArray kept;
+        {
+            JsonDocument document = JsonParser().parseDocument(text);
+            kept.push_back(std::move(document.getRoot()[0]["a_rather_long_key_name_here"]));
+            kept.push_back(std::move(document.getRoot()[1]));
+            kept.insert(kept.begin(), std::move(document.getRoot()[0]["k"]));
+        }
+        CHECK(kept[0].getAsStringView() == "v");
+        CHECK(kept[1].getAsStringView() == "a string value long enough not to fit in a small string");
+        CHECK(kept[2]["a_rather_long_key_name_here"].getAsStringView()
+              == "another long string value, borrowed from the input copy");
+
+        // The same document read again compares equal to what was kept
+        const JsonDocument again = JsonParser().parseDocument(text);
+        CHECK(kept[2] == again.getRoot()[1]);
+    }
+
+    // A document is released with its arena without walking the tree, so the values added to it, the strings
+    // owned from the input copy and what a patch puts in place are allocated in the arena (a leak check, e.g.
+    // with -fsanitize=address, reports any that is not)
+    void testEditsStayInTheArena() {
+        JsonDocument document = JsonParser().parseDocument(text);
+        JsonValue& root = document.getRoot();
+        CHECK(root[0]["k"].getAsString() == "v");
+        root[0]["a_rather_long_key_name_here"].getAsString() += ", and made longer still";
+        root.modifyJson({std::size_t(1), std::string("k")},
+                        JsonValue(JsonValue::JsonString("a replacement long enough to be allocated")), false);
+        root.addToObject({std::size_t(0)}, "an_added_key_long_enough_to_be_allocated",
+                         JsonValue(JsonValue::JsonString("an added value long enough to be allocated")));
+        root.addToArray({}, JsonValue(JsonValue::JsonString("an element long enough to be allocated")));
+
+        JsonPatch patch;
+        patch.replace({std::size_t(1), std::string("a_rather_long_key_name_here")},
+                      JsonValue(JsonValue::JsonString("patched in, long enough to be allocated")));
+        patch.apply(root);
+        CHECK(root[1]["a_rather_long_key_name_here"].getAsStringView() == "patched in, long enough to be allocated");
+
+        // Undone by the failing test: the values restored go back in place
+        JsonPatch failing;
+        failing.replace({std::size_t(0), std::string("k")},
+                        JsonValue(JsonValue::JsonString("replaced then restored, long enough")));
+        failing.test({std::size_t(0), std::string("k")}, JsonValue(JsonValue::JsonString("not the value")));
+        CHECK(throws([&] { failing.apply(root); }));
+        CHECK(root[0]["k"].getAsStringView() == "v");
+
+        JsonPatch rooted;
+        rooted.replace({}, JsonValue(JsonValue::JsonString("a whole new root, long enough to be allocated")));
+        rooted.apply(root);
+        CHECK(root.getAsStringView() == "a whole new root, long enough to be allocated");
+
+        document.setRoot(JsonValue(JsonValue::JsonString("set as the root, long enough to be allocated")));
+        document = JsonParser().parseDocument(text);
+        CHECK(document.getRoot()[1]["k"].getAsStringView() == "w");
+    }
+}
+
+int main() {
+    testKeysLeavingTheArena();
+    testBorrowedStringsLeavingTheArena();
+    testEditsStayInTheArena();
+    return checkResult();
+}
@@ -0,0 +1,58 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include <string>
+
+namespace {
+
+    // A document of a few MB whose strings hold brackets, braces, commas, quotes and backslashes, so that
+    // the segments of parseParallel are cut inside strings, escapes and nested containers
+    std::string largeDocument(bool objectRoot) {
+        std::string text = objectRoot ? "{" : "[";
+        for (int i = 0; i < 20000; ++i) {
+            if (i > 0) {
+                text += ",\n";
+            }
+            if (objectRoot) {
+                text += "\"key" + std::to_string(i) + "\": ";
+            }
+            text += "{\"id\": " + std::to_string(i) + ", \"name\": \"a [b] {c}, \\\"d\\\" \\\\\", "
+                    "\"tags\": [\"x\\\\\", \"]\", \"}\", \"\\u005b\"], \"value\": " + std::to_string(i * 0.25)
+                    + ", \"nested\": [[" + std::to_string(-i) + ", true], {\"n\": null, \"e\": {}}, []]}";
+        }
+        text += objectRoot ? "}" : "]";
+        return text;
+    }
+
+    void testParallel(bool objectRoot) {
+        const std::string text = largeDocument(objectRoot);
+        const JsonValue serial = JsonParser().parse(text);
+        for (const unsigned threads : {2u, 3u}) {
+            CHECK(JsonParser().parseParallel(text, threads) == serial);
+        }
+
+        // Invalid input is parsed again serially and throws as parse does
+        if (!objectRoot) {
+            std::string extraComma = text;
+            extraComma.insert(text.find(", \"value\"", text.size() / 2), ",");
+            CHECK(throws([&] { JsonParser().parseParallel(extraComma, 3); }));
+        }
+    }
+
+    // A document parse that fails leaves nothing from the destroyed arena to the next parse of the parser
+    void testFailedDocument() {
+        JsonParser parser;
+        CHECK(throws([&] { parser.parseDocument("{\"x\": {\"a\": [1]}, \"y\": tru}"); }));
+        CHECK(throws([&] { parser.parseDocument("[[\"a\", {\"b\": [2, 3]}], [4,"); }));
+
+        const JsonDocument document = parser.parseDocument("{\"x\": {\"a\": [1]}, \"y\": true}");
+        CHECK(document.getRoot() == parser.parse("{\"y\": true, \"x\": {\"a\": [1]}}"));
+        CHECK(parser.parse("[1, [2, {\"c\": 3}]]")[1][1]["c"] == JsonValue(JsonValue::JsonInteger(3)));
+    }
+}
+
+int main() {
+    testFailedDocument();
+    testParallel(false);
+    testParallel(true);
+    return checkResult();
+}
@@ -0,0 +1,148 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonPatch.h"
+#include "../include/JsonWriter.h"
+#include <string>
+
+namespace {
+
+    JsonValue parse(const char* text) {
+        return JsonParser().parse(text);
+    }
+
+    // The text of a value, members in their order
+    std::string text(const JsonValue& value) {
+        return JsonWriter::toString(value);
+    }
+
+    const char* const document =
+        R"({"a": 1, "b": {"x": [1, 2, 3], "y": "a string too long for a small string"}, "c": [4, 5], "d": 6})";
+
+    // A patch whose last operation fails leaves the value as it was, members back in their order, when atomic,
+    // and with the operations before the failing one applied otherwise
+    void testRollback() {
+        const JsonPatch patch(parse(R"([
+            {"op": "add", "path": "/e", "value": {"f": 7}},
+            {"op": "remove", "path": "/a"},
+            {"op": "replace", "path": "/b/x/1", "value": "two"},
+            {"op": "remove", "path": "/c/0"},
+            {"op": "move", "from": "/d", "path": "/b/z"},
+            {"op": "copy", "from": "/b/y", "path": "/b/x/-"},
+            {"op": "replace", "path": "", "value": [1]},
+            {"op": "replace", "path": "", "value": {"a": 1, "b": 2}},
+            {"op": "remove", "path": "/b"},
+            {"op": "test", "path": "/a", "value": 2}
+        ])"));
+        const JsonValue original = parse(document);
+
+        JsonValue value = parse(document);
+        CHECK(throws([&] { patch.apply(value); }));
+        CHECK(text(value) == text(original));
+
+        // The removed root member was restored in place: a later patch sees the same order
+        JsonPatch().add({std::string("g")}, JsonValue(JsonValue::JsonInteger(8))).apply(value);
+        CHECK(text(value) == text(parse(R"({"a": 1, "b": {"x": [1, 2, 3], "y": "a string too long for a small string"},)"
+                                        R"( "c": [4, 5], "d": 6, "g": 8})")));
+
+        JsonValue partial = parse(document);
+        CHECK(throws([&] { patch.apply(partial, false); }));
+        CHECK(text(partial) == text(parse(R"({"a": 1})")));
+    }
+
+    // Consecutive removes of members of one object are applied together, undone they go back to the positions
+    // they had, whichever order they were listed in
+    void testBatchedRemoves() {
+        const char* const members = R"({"a": 1, "b": 2, "c": 3, "d": 4, "e": 5, "f": 6, "g": 7, "h": 8})";
+        const JsonValue original = parse(members);
+
+        JsonValue value = parse(members);
+        const JsonPatch removes(parse(R"([
+            {"op": "remove", "path": "/f"},
+            {"op": "remove", "path": "/b"},
+            {"op": "remove", "path": "/h"},
+            {"op": "remove", "path": "/a"},
+            {"op": "remove", "path": "/d"}
+        ])"));
+        removes.apply(value);
+        CHECK(text(value) == text(parse(R"({"c": 3, "e": 5, "g": 7})")));
+
+        // Undone after a failing test, and when one member of the batch is missing
+        const char* const failures[] = {
+            R"({"op": "test", "path": "/c", "value": 0})",
+            R"({"op": "remove", "path": "/z"})"
+        };
+        for (const char* failing : failures) {
+            JsonValue operations = parse(R"([
+                {"op": "remove", "path": "/g"},
+                {"op": "remove", "path": "/b"},
+                {"op": "remove", "path": "/e"},
+                {"op": "remove", "path": "/a"}
+            ])");
+            operations.getAsArray().push_back(parse(failing));
+            value = parse(members);
+            CHECK(throws([&] { JsonPatch(operations).apply(value); }));
+            CHECK(text(value) == text(original));
+        }
+
+        // The same member twice in one batch
+        value = parse(members);
+        CHECK(throws([&] { JsonPatch().remove({std::string("c")}).remove({std::string("c")}).apply(value); }));
+        CHECK(text(value) == text(original));
+    }
+
+    // Sorting the runs of a patch by path gives the same result as applying it as written
+    void testSortedPatch() {
+        const JsonPatch patch(parse(R"([
+            {"op": "replace", "path": "/d", "value": 60},
+            {"op": "test", "path": "/b/y", "value": "a string too long for a small string"},
+            {"op": "replace", "path": "/b/x/2", "value": 30},
+            {"op": "replace", "path": "/a", "value": [10]},
+            {"op": "replace", "path": "/b/x/0", "value": 10},
+            {"op": "add", "path": "/b/w", "value": true},
+            {"op": "remove", "path": "/d"},
+            {"op": "remove", "path": "/a"},
+            {"op": "remove", "path": "/b/w"},
+            {"op": "remove", "path": "/b/y"},
+            {"op": "replace", "path": "/c/1", "value": 50},
+            {"op": "replace", "path": "/c", "value": {"n": null}},
+            {"op": "replace", "path": "/c/n", "value": 0}
+        ])"));
+        JsonPatch sorted = patch;
+        sorted.sortByPath();
+
+        JsonValue asWritten = parse(document);
+        JsonValue bySortedPath = parse(document);
+        patch.apply(asWritten);
+        sorted.apply(bySortedPath);
+        CHECK(text(asWritten) == text(parse(R"({"b": {"x": [10, 2, 30]}, "c": {"n": 0}})")));
+        CHECK(text(bySortedPath) == text(asWritten));
+    }
+
+    // The diff of two values applied to the first gives the second
+    void testDiff() {
+        const char* const pairs[][2] = {
+            {document, R"({"b": {"x": [1, 3], "y": "changed", "z": {}}, "c": [4, 5, 6, 7], "d": "6", "e": null})"},
+            {document, R"({"d": 6, "c": [4, 5], "b": {"x": [1, 2, 3], "y": "a string too long for a small string"}})"},
+            {R"([1, [2, 3], {"a": [4]}])", R"([[2, 3], {"a": [4, 5]}])"},
+            {R"([1, 2, 3, 4, 5])", R"([])"},
+            {R"({"a": {"b": {"c": 1}}})", R"({"a": {"b": {"c": 1, "d": 2}}})"},
+            {R"({"a": 1})", R"([1])"},
+            {R"("a string too long for a small string")", R"(12)"},
+            {R"({})", R"({"a": [1, {"b": 2}]})"}
+        };
+        for (const auto& pair : pairs) {
+            JsonValue from = parse(pair[0]);
+            const JsonValue to = parse(pair[1]);
+            JsonPatch::diff(from, to).apply(from);
+            CHECK(from == to);
+        }
+    }
+}
+
+int main() {
+    testRollback();
+    testBatchedRemoves();
+    testSortedPatch();
+    testDiff();
+    return checkResult();
+}
@@ -0,0 +1,110 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/PersistentDocument.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    constexpr JsonValue::JsonInteger writes = 2000;
+
+    std::string keyOf(JsonValue::JsonInteger i) {
+        return "k" + std::to_string(i);
+    }
+
+    // Whether a version holds to what the writers keep true: count follows the members of items, item ki is i,
+    // and the two values of pair, written by one update, add up to 0
+    bool consistent(const PersistentValue& root) {
+        const JsonValue::JsonInteger count = root["count"].getAsInteger();
+        const PersistentValue& items = root["items"];
+        const auto added = JsonValue::JsonInteger(items.size());
+        if (added != count && added != count + 1) {
+            return false;
+        }
+        for (const JsonValue::JsonInteger i : {JsonValue::JsonInteger(0), added / 2, added - 1}) {
+            if (i >= 0 && i < added && items[keyOf(i)].getAsInteger() != i) {
+                return false;
+            }
+        }
+        return root["pair"]["a"].getAsInteger() + root["pair"]["b"].getAsInteger() == 0;
+    }
+
+    // Readers see consistent versions, one after the other, while writers publish new ones. A snapshot kept
+    // across the writes is left as it was.
+    void testReadersAndWriters() {
+        PersistentDocument document(JsonParser().parse(R"({"count": 0, "items": {}, "pair": {"a": 0, "b": 0}})"));
+        const PersistentValue first = document.snapshot();
+
+        std::atomic<bool> done{false};
+        std::atomic<int> inconsistent{0}, backwards{0}, reads{0};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                PersistentDocument::Reader reader(document);
+                JsonValue::JsonInteger last = 0;
+                while (!done.load()) {
+                    const PersistentValue& latest = reader.get();
+                    const PersistentValue snapshot = document.snapshot();
+                    for (const PersistentValue* root : {&latest, &snapshot}) {
+                        if (!consistent(*root)) {
+                            ++inconsistent;
+                        }
+                    }
+                    // The version of get() may lag a publish in progress, but never goes back, and the snapshot
+                    // taken after it is never older
+                    const JsonValue::JsonInteger count = latest["count"].getAsInteger();
+                    if (count < last || snapshot["count"].getAsInteger() < count) {
+                        ++backwards;
+                    }
+                    last = count;
+                    ++reads;
+                }
+            });
+        }
+
+        std::thread pairWriter([&] {
+            for (JsonValue::JsonInteger i = 1; i <= writes; ++i) {
+                document.update([i](const PersistentValue& current) {
+                    return current.set({std::string("pair"), std::string("a")}, PersistentValue(JsonValue(i)))
+                                  .set({std::string("pair"), std::string("b")}, PersistentValue(JsonValue(-i)));
+                });
+            }
+        });
+        for (JsonValue::JsonInteger i = 0; i < writes; ++i) {
+            document.addToObject({std::string("items")}, keyOf(i), JsonValue(i));
+            document.modifyJson({std::string("count")}, JsonValue(i + 1));
+        }
+        pairWriter.join();
+        done = true;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+
+        CHECK(inconsistent == 0);
+        CHECK(backwards == 0);
+        CHECK(reads > 0);
+        CHECK(document.version() == std::uint64_t(3 * writes));
+
+        // Every update was kept, and the first version was not changed by them
+        const PersistentValue last = document.snapshot();
+        CHECK(consistent(last));
+        CHECK(last["count"].getAsInteger() == writes);
+        CHECK(last["items"].size() == std::size_t(writes));
+        JsonValue::JsonInteger expected = 0;
+        bool inOrder = true;
+        for (const PersistentValue::Member& member : last["items"].getAsObject()) {
+            inOrder = inOrder && member.first.view() == keyOf(expected) && member.second.getAsInteger() == expected;
+            ++expected;
+        }
+        CHECK(inOrder);
+        CHECK(last["pair"]["a"].getAsInteger() == writes);
+        CHECK(first["count"].getAsInteger() == 0 && first["items"].size() == 0);
+    }
+}
+
+int main() {
+    testReadersAndWriters();
+    return checkResult();
+}
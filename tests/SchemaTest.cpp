@@ -0,0 +1,53 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonSchema.h"
+
+namespace {
+
+    JsonSchema multipleOf(const char* divisor) {
+        return JsonSchema(JsonParser().parse(std::string(R"({"multipleOf": )") + divisor + "}"));
+    }
+
+    // Fractional divisors accept the values whose quotient is only off by the rounding of the decimals,
+    // for parsed values as for text checked by the stream validator
+    void testFractionalMultipleOf() {
+        const JsonSchema tenth = multipleOf("0.1");
+        CHECK(tenth.isValid("0.3"));
+        CHECK(tenth.isValid("0.7"));
+        CHECK(tenth.isValid("-12.3"));
+        CHECK(tenth.isValid(JsonParser().parse("[0.3]")[0]));
+        CHECK(!tenth.isValid("0.35"));
+        CHECK(!tenth.isValid("0.30001"));
+
+        const JsonSchema tenThousandth = multipleOf("0.0001");
+        CHECK(tenThousandth.isValid("0.0075"));
+        CHECK(tenThousandth.isValid("19.99"));
+        CHECK(!tenThousandth.isValid("0.00755"));
+
+        CHECK(multipleOf("0.5").isValid("7"));
+        CHECK(!multipleOf("0.5").isValid("7.25"));
+    }
+
+    // Integers are divided exactly, also past the 53 bits of a double
+    void testIntegerMultipleOf() {
+        const JsonSchema three = multipleOf("3");
+        CHECK(three.isValid("9007199254740993"));   // 2^53 + 1
+        CHECK(!three.isValid("9007199254740992"));  // 2^53
+        CHECK(three.isValid("18446744073709551615"));
+        CHECK(!three.isValid("18446744073709551614"));
+        CHECK(three.isValid("-9223372036854775806"));
+        CHECK(!three.isValid("-9223372036854775808"));
+        CHECK(three.isValid("6.0"));
+        CHECK(!three.isValid("6.5"));
+
+        CHECK(multipleOf("4611686018427387904").isValid("-9223372036854775808"));
+        CHECK(multipleOf("2.0").isValid("9007199254740994"));
+        CHECK(!multipleOf("2.0").isValid("9007199254740993"));
+    }
+}
+
+int main() {
+    testFractionalMultipleOf();
+    testIntegerMultipleOf();
+    return checkResult();
+}
@@ -0,0 +1,147 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonPath.h"
+#include "../include/SourceMap.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+    const char* const sourceFile = "sourcemap_test.json";
+    const char* const copyFile = "sourcemap_test_copy.json";
+
+    const std::string source =
+        "{\n"
+        "  \"name\" :  \"store\",\n"
+        "  \"books\": [\n"
+        "    {\"title\": \"A\", \"price\": 10,   \"tags\": [\"x\", \"y\"]},\n"
+        "    {\"title\": \"B\", \"price\": 12.5, \"tags\": []}\n"
+        "  ],\n"
+        "  \"owner\": {\"first\": \"Ann\", \"age\": 40},\n"
+        "  \"untouched\": {\"deep\": [1, 2, {\"k\": \"v\"}], \"fmt\":   [ 1 ,2 ]}\n"
+        "}\n";
+
+    const std::string untouched = "{\"deep\": [1, 2, {\"k\": \"v\"}], \"fmt\":   [ 1 ,2 ]}";
+
+    std::string readText(const char* filename) {
+        std::ifstream in(filename, std::ios::binary);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    }
+
+    void writeText(const char* filename, const std::string& text) {
+        std::ofstream(filename, std::ios::binary) << text;
+    }
+
+    // The file holds value, and the text of the untouched member is kept as it was
+    void checkSaved(const char* filename, const JsonValue& value) {
+        const std::string text = readText(filename);
+        CHECK(JsonParser().parse(text) == value);
+        CHECK(text.find(untouched) != std::string::npos);
+    }
+
+    void testUnchanged() {
+        writeText(sourceFile, source);
+        SourceMap map;
+        const JsonValue value = JsonParser().readWithSourceMap(sourceFile, map);
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        CHECK(readText(copyFile) == source);
+    }
+
+    void testInPlace() {
+        writeText(sourceFile, source);
+        SourceMap map;
+        JsonValue value = JsonParser().readWithSourceMap(sourceFile, map);
+
+        // Same width, only the digits change
+        value["books"][0]["price"] = JsonValue(JsonValue::JsonInteger(11));
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        std::string expected = source;
+        expected.replace(expected.find("10,"), 2, "11");
+        CHECK(readText(sourceFile) == expected);
+
+        // The map follows the text written in place, so the next save is patched too
+        value["owner"]["age"] = JsonValue(JsonValue::JsonInteger(4));
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        checkSaved(sourceFile, value);
+    }
+
+    void testStructuralChanges() {
+        writeText(sourceFile, source);
+        SourceMap map;
+        JsonValue value = JsonParser().readWithSourceMap(sourceFile, map);
+
+        value["owner"].getAsObject()["last"] = JsonValue(JsonValue::JsonString("Smith"));
+        value["books"][1]["tags"].getAsArray().push_back(JsonValue(JsonValue::JsonString("new")));
+        value["books"][0]["tags"].getAsArray().erase(value["books"][0]["tags"].getAsArray().begin());
+        value.getAsObject().erase("name");
+
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        checkSaved(copyFile, value);
+
+        // The changes do not fit in place, the source is rewritten whole
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        checkSaved(sourceFile, value);
+
+        // and the map still describes the text it was read from
+        value["books"][1]["price"] = JsonValue(JsonValue::JsonNumber(13.5));
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        checkSaved(copyFile, value);
+    }
+
+    // Values modified through the pointers of JsonPath, whose walk clears the hashes recorded by the map
+    void testSelectedEdits() {
+        writeText(sourceFile, source);
+        SourceMap map;
+        JsonValue value = JsonParser().readWithSourceMap(sourceFile, map);
+
+        for (JsonValue* price : JsonPath("$.books[*].price").select(value)) {
+            *price = JsonValue(JsonValue::JsonInteger(42));
+        }
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        checkSaved(copyFile, value);
+        CHECK(JsonParser().parse(readText(copyFile))["books"][1]["price"] == JsonValue(JsonValue::JsonInteger(42)));
+
+        *JsonPath("$..age").selectFirst(value) = JsonValue(JsonValue::JsonInteger(41));
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        checkSaved(sourceFile, value);
+        CHECK(JsonParser().parse(readText(sourceFile))["owner"]["age"] == JsonValue(JsonValue::JsonInteger(41)));
+    }
+
+    // A pointer kept across saves: a save must not cache hashes that the pointer can no longer clear
+    void testPointerAcrossSaves() {
+        writeText(sourceFile, source);
+        SourceMap map;
+        JsonValue value = JsonParser().readWithSourceMap(sourceFile, map);
+
+        JsonValue* age = JsonPath("$.owner.age").selectFirst(value);
+        *age = JsonValue(JsonValue::JsonInteger(41));
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        checkSaved(sourceFile, value);
+
+        *age = JsonValue(JsonValue::JsonInteger(42));
+        JsonParser().printPatchedToFile(sourceFile, value, map);
+        checkSaved(sourceFile, value);
+
+        *age = JsonValue(JsonValue::JsonInteger(43));
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        checkSaved(copyFile, value);
+        *age = JsonValue(JsonValue::JsonInteger(44));
+        JsonParser().printPatchedToFile(copyFile, value, map);
+        checkSaved(copyFile, value);
+    }
+}
+
+int main() {
+    testUnchanged();
+    testInPlace();
+    testStructuralChanges();
+    testSelectedEdits();
+    testPointerAcrossSaves();
+    std::remove(sourceFile);
+    std::remove(copyFile);
+    return checkResult();
+}
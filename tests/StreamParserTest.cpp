@@ -0,0 +1,162 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+#include "../include/JsonStreamParser.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define JSON_TEST_PIPES 1
+#endif
+
+namespace {
+
+    // The events as text, to compare two parses
+    class Recorder : public JsonHandler {
+    public:
+        std::string events;
+
+        void startObject() override { events += '{'; }
+        void key(std::string_view key) override { events += "k:" + std::string(key) + ';'; }
+        void endObject() override { events += '}'; }
+        void startArray() override { events += '['; }
+        void endArray() override { events += ']'; }
+        void string(std::string_view str) override { events += "s:" + std::string(str) + ';'; }
+        void number(JsonValue::JsonNumber num) override { events += "n:" + std::to_string(num) + ';'; }
+        void integer(JsonValue::JsonInteger num) override { events += "i:" + std::to_string(num) + ';'; }
+        void unsignedInteger(JsonValue::JsonUnsigned num) override { events += "u:" + std::to_string(num) + ';'; }
+        void boolean(JsonValue::JsonBool b) override { events += b ? "true;" : "false;"; }
+        void null() override { events += "null;"; }
+    };
+
+    const std::string text =
+        R"({"s":"a\"b\u00e9\ud83d\ude00c","n":-12345.678e-3,"big":18446744073709551615,"t":[true,null,-7]})";
+
+    // The text cut in the middle of an escape, a \u escape, a surrogate pair, numbers and a literal
+    std::vector<std::string> pieces() {
+        const std::size_t cuts[] = {
+            text.find("\\\"") + 1,
+            text.find("\\u00e9") + 4,
+            text.find("\\ude00"),
+            text.find("\\ude00") + 3,
+            text.find("-12345") + 4,
+            text.find("e-3") + 1,
+            text.find("551615") + 3,
+            text.find("true") + 2,
+            text.find("-7") + 1
+        };
+        std::vector<std::string> result;
+        std::size_t start = 0;
+        for (const std::size_t cut : cuts) {
+            result.push_back(text.substr(start, cut - start));
+            start = cut;
+        }
+        result.push_back(text.substr(start));
+        return result;
+    }
+
+#ifdef JSON_TEST_PIPES
+    // A pipe whose write end is fed the pieces by a thread, pausing between them so that every read
+    // returns at most one piece
+    class Producer {
+        int fds[2];
+        std::thread writer;
+
+    public:
+        explicit Producer(std::vector<std::string> parts) {
+            CHECK(::pipe(fds) == 0);
+            writer = std::thread([this, parts = std::move(parts)] {
+                for (const std::string& part : parts) {
+                    CHECK(::write(fds[1], part.data(), part.size()) == ssize_t(part.size()));
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+                ::close(fds[1]);
+            });
+        }
+
+        ~Producer() {
+            writer.join();
+            ::close(fds[0]);
+        }
+
+        int fd() const { return fds[0]; }
+    };
+
+    void testDescriptors() {
+        Recorder expected;
+        JsonStreamParser whole(expected);
+        whole.feed(text);
+        whole.finish();
+        CHECK(expected.events.find("s:a\"b\xC3\xA9\xF0\x9F\x98\x80" "c;") != std::string::npos);
+
+        {
+            Producer producer(pieces());
+            Recorder events;
+            JsonStreamParser::parseDescriptor(producer.fd(), events);
+            CHECK(events.events == expected.events);
+        }
+        {
+            Producer producer(pieces());
+            CHECK(JsonIncrementalParser::readDescriptor(producer.fd()) == JsonParser().parse(text));
+        }
+        {
+            // Reads of one byte split every token
+            Producer producer({text});
+            CHECK(JsonIncrementalParser::readDescriptor(producer.fd(), 1) == JsonParser().parse(text));
+        }
+        {
+            Producer producer({"[1,", "2"});
+            CHECK(throws([&] { JsonIncrementalParser::readDescriptor(producer.fd()); }));
+        }
+    }
+#endif
+
+    // The stream parsers accept and reject the same inputs as JsonParser::parse, and build the same values
+    void testAgreement() {
+        const char* inputs[] = {
+            "[,1]", "[1,,2]", "{,\"a\":1}", "{\"a\":1,,\"b\":2}", "[,]", "{,}", "[1,]", "{\"a\":1,}",
+            "[1 2]", "[1]x", "[] []", "nan", "[-inf]", "[infinity]", "[01]", "[\"a\\x\"]", "{\"a\" 1}",
+            "[1,[2,[3]],{\"b\":[]}]", " {\"a\":{\"b\":[true,false,null]}} "
+        };
+        for (const char* input : inputs) {
+            JsonValue parsed;
+            const bool parseThrows = throws([&] { parsed = JsonParser().parse(input); });
+
+            JsonIncrementalParser whole;
+            JsonValue fed;
+            const bool wholeThrows = throws([&] {
+                whole.feed(input);
+                fed = whole.finish();
+            });
+
+            JsonIncrementalParser bytes;
+            JsonValue fedBytes;
+            const bool bytesThrow = throws([&] {
+                for (const char* c = input; *c != '\0'; ++c) {
+                    bytes.feed(c, 1);
+                }
+                fedBytes = bytes.finish();
+            });
+
+            if (parseThrows != wholeThrows || parseThrows != bytesThrow) {
+                std::cerr << "disagreement on " << input << std::endl;
+            }
+            CHECK(parseThrows == wholeThrows);
+            CHECK(parseThrows == bytesThrow);
+            if (!parseThrows) {
+                CHECK(fed == parsed);
+                CHECK(fedBytes == parsed);
+            }
+        }
+    }
+}
+
+int main() {
+#ifdef JSON_TEST_PIPES
+    testDescriptors();
+#endif
+    testAgreement();
+    return checkResult();
+}
@@ -0,0 +1,25 @@
+#include "Check.h"
+#include "../include/JsonParser.h"
+
+namespace {
+
+    // A value moved from inside the one it is assigned to is taken before the old tree is released
+    void testMoveFromInside() {
+        JsonValue value = JsonParser().parse(R"({"a": {"b": [1, "a string too long for a small string"]}, "c": 2})");
+        value = std::move(value["a"]);
+        CHECK(value == JsonParser().parse(R"({"b": [1, "a string too long for a small string"]})"));
+
+        value = std::move(value["b"]);
+        value = std::move(value[1]);
+        CHECK(value.getAsStringView() == "a string too long for a small string");
+
+        JsonValue array = JsonParser().parse(R"([[[3]]])");
+        array = std::move(array[0][0]);
+        CHECK(array == JsonParser().parse("[3]"));
+    }
+}
+
+int main() {
+    testMoveFromInside();
+    return checkResult();
+}